@@ -38,3 +38,56 @@ void getInfluenceFunctionKM(Rcpp::NumericVector& time, Rcpp::NumericVector& stat
   }
   MC_term2 = arma::cumsum(MC_term2);
 }
+
+// Check that the output of getInfluenceFunctionKMStructure has been computed on the same (sorted) data:
+// each time must match its unique time and the number of censored observations at each unique time must agree.
+bool sameKMStructure(const Rcpp::NumericVector& time, const Rcpp::NumericVector& status, const Rcpp::List& KMlist){
+  if (!KMlist.containsElementNamed("sindex") || !KMlist.containsElementNamed("utime") || !KMlist.containsElementNamed("ncens")){
+    return false;
+  }
+  Rcpp::IntegerVector KMsindex = KMlist["sindex"];
+  Rcpp::NumericVector KMutime = KMlist["utime"];
+  Rcpp::IntegerVector KMncens = KMlist["ncens"];
+  int n = time.size();
+  int nu = KMutime.size();
+  if (KMsindex.size() != n || KMncens.size() != nu){
+    return false;
+  }
+  std::vector<int> ncens(nu,0);
+  for (int i = 0; i < n; i++){
+    int t = KMsindex[i];
+    if (t < 0 || t >= nu || KMutime[t] != time[i]){
+      return false;
+    }
+    ncens[t] += (status[i] == 0);
+  }
+  for (int t = 0; t < nu; t++){
+    if (ncens[t] != KMncens[t]){
+      return false;
+    }
+  }
+  return true;
+}
+
+// Same as above but re-use the output of getInfluenceFunctionKMStructure when available,
+// i.e. when it has been computed once on the same (sorted) data.
+// Otherwise atrisk, MC_term2, sindex, and utime are computed and allocated here.
+void getInfluenceFunctionKM(Rcpp::NumericVector& time, Rcpp::NumericVector& status, const Rcpp::Nullable<Rcpp::List>& KM, arma::vec& atrisk,arma::vec& MC_term2,arma::uvec& sindex,arma::vec& utime){
+  int n = time.size();
+  if (KM.isNotNull()){
+    Rcpp::List KMlist(KM);
+    if (sameKMStructure(time,status,KMlist)){
+      atrisk = Rcpp::as<arma::vec>(KMlist["atrisk"]);
+      MC_term2 = Rcpp::as<arma::vec>(KMlist["MC_term2"]);
+      sindex = Rcpp::as<arma::uvec>(KMlist["sindex"]);
+      utime = Rcpp::as<arma::vec>(KMlist["utime"]);
+      return;
+    }
+  }
+  sindex.zeros(n);
+  utime = arma::unique(Rcpp::as<arma::vec>(time));
+  int nu = utime.size();
+  atrisk.set_size(nu);
+  MC_term2.zeros(nu);
+  getInfluenceFunctionKM(time,status,atrisk,MC_term2,sindex,utime);
+}
@@ -2,3 +2,4 @@
 
 void getInfluenceFunctionKM(Rcpp::NumericVector& time, Rcpp::NumericVector& status,arma::vec& atrisk,arma::vec& MC_term2,arma::uvec& sindex,arma::vec& utime);
 
+void getInfluenceFunctionKM(Rcpp::NumericVector& time, Rcpp::NumericVector& status, const Rcpp::Nullable<Rcpp::List>& KM, arma::vec& atrisk,arma::vec& MC_term2,arma::uvec& sindex,arma::vec& utime);
@@ -26,9 +26,47 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// getOobBits
+NumericMatrix getOobBits(IntegerVector ID, IntegerVector bootstrap, int N, int B);
+RcppExport SEXP _riskRegression_getOobBits(SEXP IDSEXP, SEXP bootstrapSEXP, SEXP NSEXP, SEXP BSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< IntegerVector >::type ID(IDSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type bootstrap(bootstrapSEXP);
+    Rcpp::traits::input_parameter< int >::type N(NSEXP);
+    Rcpp::traits::input_parameter< int >::type B(BSEXP);
+    rcpp_result_gen = Rcpp::wrap(getOobBits(ID, bootstrap, N, B));
+    return rcpp_result_gen;
+END_RCPP
+}
+// countOobBits
+IntegerVector countOobBits(NumericMatrix oobBits);
+RcppExport SEXP _riskRegression_countOobBits(SEXP oobBitsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type oobBits(oobBitsSEXP);
+    rcpp_result_gen = Rcpp::wrap(countOobBits(oobBits));
+    return rcpp_result_gen;
+END_RCPP
+}
+// aucLoobBitFun
+List aucLoobBitFun(IntegerVector IDCase, IntegerVector IDControl, NumericMatrix riskMat, NumericMatrix oobBits, NumericVector weights, int ncores);
+RcppExport SEXP _riskRegression_aucLoobBitFun(SEXP IDCaseSEXP, SEXP IDControlSEXP, SEXP riskMatSEXP, SEXP oobBitsSEXP, SEXP weightsSEXP, SEXP ncoresSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< IntegerVector >::type IDCase(IDCaseSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type IDControl(IDControlSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type riskMat(riskMatSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type oobBits(oobBitsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type weights(weightsSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(aucLoobBitFun(IDCase, IDControl, riskMat, oobBits, weights, ncores));
+    return rcpp_result_gen;
+END_RCPP
+}
 // baseHaz_cpp
-List baseHaz_cpp(const NumericVector& starttimes, const NumericVector& stoptimes, const IntegerVector& status, const NumericVector& eXb, const IntegerVector& strata, const std::vector<double>& predtimes, const NumericVector& emaxtimes, int nPatients, int nStrata, int cause, bool Efron, bool reverse);
-RcppExport SEXP _riskRegression_baseHaz_cpp(SEXP starttimesSEXP, SEXP stoptimesSEXP, SEXP statusSEXP, SEXP eXbSEXP, SEXP strataSEXP, SEXP predtimesSEXP, SEXP emaxtimesSEXP, SEXP nPatientsSEXP, SEXP nStrataSEXP, SEXP causeSEXP, SEXP EfronSEXP, SEXP reverseSEXP) {
+List baseHaz_cpp(const NumericVector& starttimes, const NumericVector& stoptimes, const IntegerVector& status, const NumericVector& eXb, const IntegerVector& strata, const std::vector<double>& predtimes, const NumericVector& emaxtimes, int nPatients, int nStrata, int cause, bool Efron, bool reverse, Nullable<IntegerVector> multiplicity);
+RcppExport SEXP _riskRegression_baseHaz_cpp(SEXP starttimesSEXP, SEXP stoptimesSEXP, SEXP statusSEXP, SEXP eXbSEXP, SEXP strataSEXP, SEXP predtimesSEXP, SEXP emaxtimesSEXP, SEXP nPatientsSEXP, SEXP nStrataSEXP, SEXP causeSEXP, SEXP EfronSEXP, SEXP reverseSEXP, SEXP multiplicitySEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -44,7 +82,25 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< int >::type cause(causeSEXP);
     Rcpp::traits::input_parameter< bool >::type Efron(EfronSEXP);
     Rcpp::traits::input_parameter< bool >::type reverse(reverseSEXP);
-    rcpp_result_gen = Rcpp::wrap(baseHaz_cpp(starttimes, stoptimes, status, eXb, strata, predtimes, emaxtimes, nPatients, nStrata, cause, Efron, reverse));
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type multiplicity(multiplicitySEXP);
+    rcpp_result_gen = Rcpp::wrap(baseHaz_cpp(starttimes, stoptimes, status, eXb, strata, predtimes, emaxtimes, nPatients, nStrata, cause, Efron, reverse, multiplicity));
+    return rcpp_result_gen;
+END_RCPP
+}
+// ipcw_cpp
+List ipcw_cpp(const NumericVector& time, const IntegerVector& status, const NumericVector& eXb, const IntegerVector& strata, int nStrata, const std::vector<double>& times, Nullable<IntegerVector> index, bool productLimit);
+RcppExport SEXP _riskRegression_ipcw_cpp(SEXP timeSEXP, SEXP statusSEXP, SEXP eXbSEXP, SEXP strataSEXP, SEXP nStrataSEXP, SEXP timesSEXP, SEXP indexSEXP, SEXP productLimitSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< const NumericVector& >::type time(timeSEXP);
+    Rcpp::traits::input_parameter< const IntegerVector& >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< const NumericVector& >::type eXb(eXbSEXP);
+    Rcpp::traits::input_parameter< const IntegerVector& >::type strata(strataSEXP);
+    Rcpp::traits::input_parameter< int >::type nStrata(nStrataSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type times(timesSEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type index(indexSEXP);
+    Rcpp::traits::input_parameter< bool >::type productLimit(productLimitSEXP);
+    rcpp_result_gen = Rcpp::wrap(ipcw_cpp(time, status, eXb, strata, nStrata, times, index, productLimit));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -130,8 +186,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // calcSeMinimalCox_cpp
-List calcSeMinimalCox_cpp(const arma::vec& seqTau, const arma::mat& newSurvival, const std::vector< arma::vec >& hazard0, const std::vector< arma::vec >& cumhazard0, const arma::mat& newX, const arma::vec& neweXb, const arma::mat& IFbeta, const std::vector< arma::mat >& Ehazard0, const std::vector< arma::mat >& cumEhazard0, const std::vector< arma::vec >& hazard_iS0, const std::vector< arma::vec >& cumhazard_iS0, const arma::mat& delta_iS0, const arma::mat& sample_eXb, const arma::vec& sample_time, const std::vector< arma::uvec>& indexJumpSample_time, const std::vector< arma::vec>& jump_time, const std::vector< arma::uvec >& indexJumpTau, const arma::vec& lastSampleTime, const std::vector< arma::uvec>& newdata_index, const std::vector<arma::mat>& factor, int nTau, int nNewObs, int nSample, int nStrata, int p, bool diag, bool exportSE, bool exportIF, bool exportIFmean, bool exportHazard, bool exportCumhazard, bool exportSurvival, int debug);
-RcppExport SEXP _riskRegression_calcSeMinimalCox_cpp(SEXP seqTauSEXP, SEXP newSurvivalSEXP, SEXP hazard0SEXP, SEXP cumhazard0SEXP, SEXP newXSEXP, SEXP neweXbSEXP, SEXP IFbetaSEXP, SEXP Ehazard0SEXP, SEXP cumEhazard0SEXP, SEXP hazard_iS0SEXP, SEXP cumhazard_iS0SEXP, SEXP delta_iS0SEXP, SEXP sample_eXbSEXP, SEXP sample_timeSEXP, SEXP indexJumpSample_timeSEXP, SEXP jump_timeSEXP, SEXP indexJumpTauSEXP, SEXP lastSampleTimeSEXP, SEXP newdata_indexSEXP, SEXP factorSEXP, SEXP nTauSEXP, SEXP nNewObsSEXP, SEXP nSampleSEXP, SEXP nStrataSEXP, SEXP pSEXP, SEXP diagSEXP, SEXP exportSESEXP, SEXP exportIFSEXP, SEXP exportIFmeanSEXP, SEXP exportHazardSEXP, SEXP exportCumhazardSEXP, SEXP exportSurvivalSEXP, SEXP debugSEXP) {
+List calcSeMinimalCox_cpp(const arma::vec& seqTau, const arma::mat& newSurvival, const std::vector< arma::vec >& hazard0, const std::vector< arma::vec >& cumhazard0, const arma::mat& newX, const arma::vec& neweXb, const arma::mat& IFbeta, const std::vector< arma::mat >& Ehazard0, const std::vector< arma::mat >& cumEhazard0, const std::vector< arma::vec >& hazard_iS0, const std::vector< arma::vec >& cumhazard_iS0, const arma::mat& delta_iS0, const arma::mat& sample_eXb, const arma::vec& sample_time, const std::vector< arma::uvec>& indexJumpSample_time, const std::vector< arma::vec>& jump_time, const std::vector< arma::uvec >& indexJumpTau, const arma::vec& lastSampleTime, const std::vector< arma::uvec>& newdata_index, const std::vector<arma::mat>& factor, int nTau, int nNewObs, int nSample, int nStrata, int p, bool diag, bool exportSE, bool exportIF, bool exportIFmean, bool exportHazard, bool exportCumhazard, bool exportSurvival, int debug, bool floatIF);
+RcppExport SEXP _riskRegression_calcSeMinimalCox_cpp(SEXP seqTauSEXP, SEXP newSurvivalSEXP, SEXP hazard0SEXP, SEXP cumhazard0SEXP, SEXP newXSEXP, SEXP neweXbSEXP, SEXP IFbetaSEXP, SEXP Ehazard0SEXP, SEXP cumEhazard0SEXP, SEXP hazard_iS0SEXP, SEXP cumhazard_iS0SEXP, SEXP delta_iS0SEXP, SEXP sample_eXbSEXP, SEXP sample_timeSEXP, SEXP indexJumpSample_timeSEXP, SEXP jump_timeSEXP, SEXP indexJumpTauSEXP, SEXP lastSampleTimeSEXP, SEXP newdata_indexSEXP, SEXP factorSEXP, SEXP nTauSEXP, SEXP nNewObsSEXP, SEXP nSampleSEXP, SEXP nStrataSEXP, SEXP pSEXP, SEXP diagSEXP, SEXP exportSESEXP, SEXP exportIFSEXP, SEXP exportIFmeanSEXP, SEXP exportHazardSEXP, SEXP exportCumhazardSEXP, SEXP exportSurvivalSEXP, SEXP debugSEXP, SEXP floatIFSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -168,7 +224,8 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type exportCumhazard(exportCumhazardSEXP);
     Rcpp::traits::input_parameter< bool >::type exportSurvival(exportSurvivalSEXP);
     Rcpp::traits::input_parameter< int >::type debug(debugSEXP);
-    rcpp_result_gen = Rcpp::wrap(calcSeMinimalCox_cpp(seqTau, newSurvival, hazard0, cumhazard0, newX, neweXb, IFbeta, Ehazard0, cumEhazard0, hazard_iS0, cumhazard_iS0, delta_iS0, sample_eXb, sample_time, indexJumpSample_time, jump_time, indexJumpTau, lastSampleTime, newdata_index, factor, nTau, nNewObs, nSample, nStrata, p, diag, exportSE, exportIF, exportIFmean, exportHazard, exportCumhazard, exportSurvival, debug));
+    Rcpp::traits::input_parameter< bool >::type floatIF(floatIFSEXP);
+    rcpp_result_gen = Rcpp::wrap(calcSeMinimalCox_cpp(seqTau, newSurvival, hazard0, cumhazard0, newX, neweXb, IFbeta, Ehazard0, cumEhazard0, hazard_iS0, cumhazard_iS0, delta_iS0, sample_eXb, sample_time, indexJumpSample_time, jump_time, indexJumpTau, lastSampleTime, newdata_index, factor, nTau, nNewObs, nSample, nStrata, p, diag, exportSE, exportIF, exportIFmean, exportHazard, exportCumhazard, exportSurvival, debug, floatIF));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -200,31 +257,51 @@ BEGIN_RCPP
 END_RCPP
 }
 // calculateDelongCovarianceFast
-NumericMatrix calculateDelongCovarianceFast(NumericMatrix& Xs, NumericMatrix& Ys);
-RcppExport SEXP _riskRegression_calculateDelongCovarianceFast(SEXP XsSEXP, SEXP YsSEXP) {
+NumericMatrix calculateDelongCovarianceFast(NumericMatrix& Xs, NumericMatrix& Ys, int ncores);
+RcppExport SEXP _riskRegression_calculateDelongCovarianceFast(SEXP XsSEXP, SEXP YsSEXP, SEXP ncoresSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< NumericMatrix& >::type Xs(XsSEXP);
     Rcpp::traits::input_parameter< NumericMatrix& >::type Ys(YsSEXP);
-    rcpp_result_gen = Rcpp::wrap(calculateDelongCovarianceFast(Xs, Ys));
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(calculateDelongCovarianceFast(Xs, Ys, ncores));
+    return rcpp_result_gen;
+END_RCPP
+}
+// calculateDelongCovarianceWeighted
+List calculateDelongCovarianceWeighted(NumericMatrix& Xs, NumericMatrix& Ys, NumericVector weightsX, NumericVector weightsY, IntegerVector clusterX, IntegerVector clusterY, int ncores);
+RcppExport SEXP _riskRegression_calculateDelongCovarianceWeighted(SEXP XsSEXP, SEXP YsSEXP, SEXP weightsXSEXP, SEXP weightsYSEXP, SEXP clusterXSEXP, SEXP clusterYSEXP, SEXP ncoresSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix& >::type Xs(XsSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix& >::type Ys(YsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type weightsX(weightsXSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type weightsY(weightsYSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type clusterX(clusterXSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type clusterY(clusterYSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(calculateDelongCovarianceWeighted(Xs, Ys, weightsX, weightsY, clusterX, clusterY, ncores));
     return rcpp_result_gen;
 END_RCPP
 }
 // colCumSum
-NumericMatrix colCumSum(NumericMatrix x);
-RcppExport SEXP _riskRegression_colCumSum(SEXP xSEXP) {
+NumericMatrix colCumSum(NumericMatrix x, bool inplace, int ncores);
+RcppExport SEXP _riskRegression_colCumSum(SEXP xSEXP, SEXP inplaceSEXP, SEXP ncoresSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< NumericMatrix >::type x(xSEXP);
-    rcpp_result_gen = Rcpp::wrap(colCumSum(x));
+    Rcpp::traits::input_parameter< bool >::type inplace(inplaceSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(colCumSum(x, inplace, ncores));
     return rcpp_result_gen;
 END_RCPP
 }
 // quantileProcess_cpp
-NumericVector quantileProcess_cpp(int nSample, int nContrast, int nSim, arma::cube& iid, int alternative, bool global, double confLevel);
-RcppExport SEXP _riskRegression_quantileProcess_cpp(SEXP nSampleSEXP, SEXP nContrastSEXP, SEXP nSimSEXP, SEXP iidSEXP, SEXP alternativeSEXP, SEXP globalSEXP, SEXP confLevelSEXP) {
+NumericVector quantileProcess_cpp(int nSample, int nContrast, int nSim, arma::cube& iid, int alternative, bool global, double confLevel, bool counterRNG, int ncores, int blockSize, bool streaming);
+RcppExport SEXP _riskRegression_quantileProcess_cpp(SEXP nSampleSEXP, SEXP nContrastSEXP, SEXP nSimSEXP, SEXP iidSEXP, SEXP alternativeSEXP, SEXP globalSEXP, SEXP confLevelSEXP, SEXP counterRNGSEXP, SEXP ncoresSEXP, SEXP blockSizeSEXP, SEXP streamingSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -235,13 +312,17 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< int >::type alternative(alternativeSEXP);
     Rcpp::traits::input_parameter< bool >::type global(globalSEXP);
     Rcpp::traits::input_parameter< double >::type confLevel(confLevelSEXP);
-    rcpp_result_gen = Rcpp::wrap(quantileProcess_cpp(nSample, nContrast, nSim, iid, alternative, global, confLevel));
+    Rcpp::traits::input_parameter< bool >::type counterRNG(counterRNGSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    Rcpp::traits::input_parameter< int >::type blockSize(blockSizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type streaming(streamingSEXP);
+    rcpp_result_gen = Rcpp::wrap(quantileProcess_cpp(nSample, nContrast, nSim, iid, alternative, global, confLevel, counterRNG, ncores, blockSize, streaming));
     return rcpp_result_gen;
 END_RCPP
 }
 // pProcess_cpp
-arma::mat pProcess_cpp(int nSample, int nContrast, int nTime, int nSim, arma::mat value, arma::cube& iid, int alternative, bool global);
-RcppExport SEXP _riskRegression_pProcess_cpp(SEXP nSampleSEXP, SEXP nContrastSEXP, SEXP nTimeSEXP, SEXP nSimSEXP, SEXP valueSEXP, SEXP iidSEXP, SEXP alternativeSEXP, SEXP globalSEXP) {
+arma::mat pProcess_cpp(int nSample, int nContrast, int nTime, int nSim, arma::mat value, arma::cube& iid, int alternative, bool global, bool counterRNG, int ncores, int blockSize);
+RcppExport SEXP _riskRegression_pProcess_cpp(SEXP nSampleSEXP, SEXP nContrastSEXP, SEXP nTimeSEXP, SEXP nSimSEXP, SEXP valueSEXP, SEXP iidSEXP, SEXP alternativeSEXP, SEXP globalSEXP, SEXP counterRNGSEXP, SEXP ncoresSEXP, SEXP blockSizeSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -253,13 +334,38 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< arma::cube& >::type iid(iidSEXP);
     Rcpp::traits::input_parameter< int >::type alternative(alternativeSEXP);
     Rcpp::traits::input_parameter< bool >::type global(globalSEXP);
-    rcpp_result_gen = Rcpp::wrap(pProcess_cpp(nSample, nContrast, nTime, nSim, value, iid, alternative, global));
+    Rcpp::traits::input_parameter< bool >::type counterRNG(counterRNGSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    Rcpp::traits::input_parameter< int >::type blockSize(blockSizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(pProcess_cpp(nSample, nContrast, nTime, nSim, value, iid, alternative, global, counterRNG, ncores, blockSize));
+    return rcpp_result_gen;
+END_RCPP
+}
+// pProcessAdaptive_cpp
+List pProcessAdaptive_cpp(int nSample, int nContrast, int nTime, int nSim, arma::mat value, arma::cube& iid, int alternative, bool global, NumericVector alpha, double confStop, bool counterRNG, int blockSize);
+RcppExport SEXP _riskRegression_pProcessAdaptive_cpp(SEXP nSampleSEXP, SEXP nContrastSEXP, SEXP nTimeSEXP, SEXP nSimSEXP, SEXP valueSEXP, SEXP iidSEXP, SEXP alternativeSEXP, SEXP globalSEXP, SEXP alphaSEXP, SEXP confStopSEXP, SEXP counterRNGSEXP, SEXP blockSizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type nSample(nSampleSEXP);
+    Rcpp::traits::input_parameter< int >::type nContrast(nContrastSEXP);
+    Rcpp::traits::input_parameter< int >::type nTime(nTimeSEXP);
+    Rcpp::traits::input_parameter< int >::type nSim(nSimSEXP);
+    Rcpp::traits::input_parameter< arma::mat >::type value(valueSEXP);
+    Rcpp::traits::input_parameter< arma::cube& >::type iid(iidSEXP);
+    Rcpp::traits::input_parameter< int >::type alternative(alternativeSEXP);
+    Rcpp::traits::input_parameter< bool >::type global(globalSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type alpha(alphaSEXP);
+    Rcpp::traits::input_parameter< double >::type confStop(confStopSEXP);
+    Rcpp::traits::input_parameter< bool >::type counterRNG(counterRNGSEXP);
+    Rcpp::traits::input_parameter< int >::type blockSize(blockSizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(pProcessAdaptive_cpp(nSample, nContrast, nTime, nSim, value, iid, alternative, global, alpha, confStop, counterRNG, blockSize));
     return rcpp_result_gen;
 END_RCPP
 }
 // sampleMaxProcess_cpp
-arma::mat sampleMaxProcess_cpp(int nSample, int nContrast, int nSim, const arma::mat& value, arma::cube& iid, int alternative, int type, bool global);
-RcppExport SEXP _riskRegression_sampleMaxProcess_cpp(SEXP nSampleSEXP, SEXP nContrastSEXP, SEXP nSimSEXP, SEXP valueSEXP, SEXP iidSEXP, SEXP alternativeSEXP, SEXP typeSEXP, SEXP globalSEXP) {
+arma::mat sampleMaxProcess_cpp(int nSample, int nContrast, int nSim, const arma::mat& value, arma::cube& iid, int alternative, int type, bool global, bool counterRNG, int ncores, int blockSize);
+RcppExport SEXP _riskRegression_sampleMaxProcess_cpp(SEXP nSampleSEXP, SEXP nContrastSEXP, SEXP nSimSEXP, SEXP valueSEXP, SEXP iidSEXP, SEXP alternativeSEXP, SEXP typeSEXP, SEXP globalSEXP, SEXP counterRNGSEXP, SEXP ncoresSEXP, SEXP blockSizeSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -271,13 +377,50 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< int >::type alternative(alternativeSEXP);
     Rcpp::traits::input_parameter< int >::type type(typeSEXP);
     Rcpp::traits::input_parameter< bool >::type global(globalSEXP);
-    rcpp_result_gen = Rcpp::wrap(sampleMaxProcess_cpp(nSample, nContrast, nSim, value, iid, alternative, type, global));
+    Rcpp::traits::input_parameter< bool >::type counterRNG(counterRNGSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    Rcpp::traits::input_parameter< int >::type blockSize(blockSizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(sampleMaxProcess_cpp(nSample, nContrast, nSim, value, iid, alternative, type, global, counterRNG, ncores, blockSize));
+    return rcpp_result_gen;
+END_RCPP
+}
+// simulateProcess_cpp
+List simulateProcess_cpp(int nSample, int nContrast, int nSim, const arma::mat& value, arma::cube& iid, int alternative, bool global, double confLevel, bool counterRNG, int ncores, int blockSize);
+RcppExport SEXP _riskRegression_simulateProcess_cpp(SEXP nSampleSEXP, SEXP nContrastSEXP, SEXP nSimSEXP, SEXP valueSEXP, SEXP iidSEXP, SEXP alternativeSEXP, SEXP globalSEXP, SEXP confLevelSEXP, SEXP counterRNGSEXP, SEXP ncoresSEXP, SEXP blockSizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type nSample(nSampleSEXP);
+    Rcpp::traits::input_parameter< int >::type nContrast(nContrastSEXP);
+    Rcpp::traits::input_parameter< int >::type nSim(nSimSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type value(valueSEXP);
+    Rcpp::traits::input_parameter< arma::cube& >::type iid(iidSEXP);
+    Rcpp::traits::input_parameter< int >::type alternative(alternativeSEXP);
+    Rcpp::traits::input_parameter< bool >::type global(globalSEXP);
+    Rcpp::traits::input_parameter< double >::type confLevel(confLevelSEXP);
+    Rcpp::traits::input_parameter< bool >::type counterRNG(counterRNGSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    Rcpp::traits::input_parameter< int >::type blockSize(blockSizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(simulateProcess_cpp(nSample, nContrast, nSim, value, iid, alternative, global, confLevel, counterRNG, ncores, blockSize));
+    return rcpp_result_gen;
+END_RCPP
+}
+// lowRankProcess_cpp
+arma::cube lowRankProcess_cpp(arma::cube& iid, int rank, double tol);
+RcppExport SEXP _riskRegression_lowRankProcess_cpp(SEXP iidSEXP, SEXP rankSEXP, SEXP tolSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< arma::cube& >::type iid(iidSEXP);
+    Rcpp::traits::input_parameter< int >::type rank(rankSEXP);
+    Rcpp::traits::input_parameter< double >::type tol(tolSEXP);
+    rcpp_result_gen = Rcpp::wrap(lowRankProcess_cpp(iid, rank, tol));
     return rcpp_result_gen;
 END_RCPP
 }
 // getIC0AUC
-List getIC0AUC(NumericVector time, NumericVector status, double tau, NumericVector risk, NumericVector GTiminus, NumericVector Gtau, double auc);
-RcppExport SEXP _riskRegression_getIC0AUC(SEXP timeSEXP, SEXP statusSEXP, SEXP tauSEXP, SEXP riskSEXP, SEXP GTiminusSEXP, SEXP GtauSEXP, SEXP aucSEXP) {
+List getIC0AUC(NumericVector time, NumericVector status, double tau, NumericVector risk, NumericVector GTiminus, NumericVector Gtau, double auc, Nullable<IntegerVector> index);
+RcppExport SEXP _riskRegression_getIC0AUC(SEXP timeSEXP, SEXP statusSEXP, SEXP tauSEXP, SEXP riskSEXP, SEXP GTiminusSEXP, SEXP GtauSEXP, SEXP aucSEXP, SEXP indexSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< NumericVector >::type time(timeSEXP);
@@ -287,13 +430,14 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericVector >::type GTiminus(GTiminusSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type Gtau(GtauSEXP);
     Rcpp::traits::input_parameter< double >::type auc(aucSEXP);
-    rcpp_result_gen = Rcpp::wrap(getIC0AUC(time, status, tau, risk, GTiminus, Gtau, auc));
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type index(indexSEXP);
+    rcpp_result_gen = Rcpp::wrap(getIC0AUC(time, status, tau, risk, GTiminus, Gtau, auc, index));
     return rcpp_result_gen;
 END_RCPP
 }
 // getInfluenceFunctionAUCKMCensoringTerm
-NumericVector getInfluenceFunctionAUCKMCensoringTerm(NumericVector time, NumericVector status, double tau, NumericVector ic0Case, NumericVector ic0Controls, NumericVector weights, int firsthit, double muCase, double muControls, double nu1, double Gtau, double auc, int startControls1);
-RcppExport SEXP _riskRegression_getInfluenceFunctionAUCKMCensoringTerm(SEXP timeSEXP, SEXP statusSEXP, SEXP tauSEXP, SEXP ic0CaseSEXP, SEXP ic0ControlsSEXP, SEXP weightsSEXP, SEXP firsthitSEXP, SEXP muCaseSEXP, SEXP muControlsSEXP, SEXP nu1SEXP, SEXP GtauSEXP, SEXP aucSEXP, SEXP startControls1SEXP) {
+NumericVector getInfluenceFunctionAUCKMCensoringTerm(NumericVector time, NumericVector status, double tau, NumericVector ic0Case, NumericVector ic0Controls, NumericVector weights, int firsthit, double muCase, double muControls, double nu1, double Gtau, double auc, int startControls1, Nullable<List> KM);
+RcppExport SEXP _riskRegression_getInfluenceFunctionAUCKMCensoringTerm(SEXP timeSEXP, SEXP statusSEXP, SEXP tauSEXP, SEXP ic0CaseSEXP, SEXP ic0ControlsSEXP, SEXP weightsSEXP, SEXP firsthitSEXP, SEXP muCaseSEXP, SEXP muControlsSEXP, SEXP nu1SEXP, SEXP GtauSEXP, SEXP aucSEXP, SEXP startControls1SEXP, SEXP KMSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< NumericVector >::type time(timeSEXP);
@@ -309,26 +453,71 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type Gtau(GtauSEXP);
     Rcpp::traits::input_parameter< double >::type auc(aucSEXP);
     Rcpp::traits::input_parameter< int >::type startControls1(startControls1SEXP);
-    rcpp_result_gen = Rcpp::wrap(getInfluenceFunctionAUCKMCensoringTerm(time, status, tau, ic0Case, ic0Controls, weights, firsthit, muCase, muControls, nu1, Gtau, auc, startControls1));
+    Rcpp::traits::input_parameter< Nullable<List> >::type KM(KMSEXP);
+    rcpp_result_gen = Rcpp::wrap(getInfluenceFunctionAUCKMCensoringTerm(time, status, tau, ic0Case, ic0Controls, weights, firsthit, muCase, muControls, nu1, Gtau, auc, startControls1, KM));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getInfluenceFunctionAUCKM
+List getInfluenceFunctionAUCKM(NumericVector time, NumericVector status, NumericVector tau, NumericMatrix risk, NumericVector GTiminus, NumericMatrix Gtau, bool iid, bool conservative, Nullable<List> KM);
+RcppExport SEXP _riskRegression_getInfluenceFunctionAUCKM(SEXP timeSEXP, SEXP statusSEXP, SEXP tauSEXP, SEXP riskSEXP, SEXP GTiminusSEXP, SEXP GtauSEXP, SEXP iidSEXP, SEXP conservativeSEXP, SEXP KMSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type time(timeSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type tau(tauSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type risk(riskSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type GTiminus(GTiminusSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type Gtau(GtauSEXP);
+    Rcpp::traits::input_parameter< bool >::type iid(iidSEXP);
+    Rcpp::traits::input_parameter< bool >::type conservative(conservativeSEXP);
+    Rcpp::traits::input_parameter< Nullable<List> >::type KM(KMSEXP);
+    rcpp_result_gen = Rcpp::wrap(getInfluenceFunctionAUCKM(time, status, tau, risk, GTiminus, Gtau, iid, conservative, KM));
     return rcpp_result_gen;
 END_RCPP
 }
 // getInfluenceFunctionBrierKMCensoringTerm
-NumericVector getInfluenceFunctionBrierKMCensoringTerm(double tau, NumericVector time, NumericVector residuals, NumericVector status);
-RcppExport SEXP _riskRegression_getInfluenceFunctionBrierKMCensoringTerm(SEXP tauSEXP, SEXP timeSEXP, SEXP residualsSEXP, SEXP statusSEXP) {
+NumericVector getInfluenceFunctionBrierKMCensoringTerm(double tau, NumericVector time, NumericVector residuals, NumericVector status, Nullable<List> KM);
+RcppExport SEXP _riskRegression_getInfluenceFunctionBrierKMCensoringTerm(SEXP tauSEXP, SEXP timeSEXP, SEXP residualsSEXP, SEXP statusSEXP, SEXP KMSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< double >::type tau(tauSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type time(timeSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type residuals(residualsSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type status(statusSEXP);
-    rcpp_result_gen = Rcpp::wrap(getInfluenceFunctionBrierKMCensoringTerm(tau, time, residuals, status));
+    Rcpp::traits::input_parameter< Nullable<List> >::type KM(KMSEXP);
+    rcpp_result_gen = Rcpp::wrap(getInfluenceFunctionBrierKMCensoringTerm(tau, time, residuals, status, KM));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getInfluenceFunctionBrierKMCensoringTermMultipleTimes
+NumericMatrix getInfluenceFunctionBrierKMCensoringTermMultipleTimes(NumericVector tau, NumericVector time, NumericMatrix residuals, NumericVector status, Nullable<List> KM);
+RcppExport SEXP _riskRegression_getInfluenceFunctionBrierKMCensoringTermMultipleTimes(SEXP tauSEXP, SEXP timeSEXP, SEXP residualsSEXP, SEXP statusSEXP, SEXP KMSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type tau(tauSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type time(timeSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type residuals(residualsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type status(statusSEXP);
+    Rcpp::traits::input_parameter< Nullable<List> >::type KM(KMSEXP);
+    rcpp_result_gen = Rcpp::wrap(getInfluenceFunctionBrierKMCensoringTermMultipleTimes(tau, time, residuals, status, KM));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getInfluenceFunctionKMStructure
+List getInfluenceFunctionKMStructure(NumericVector time, NumericVector status);
+RcppExport SEXP _riskRegression_getInfluenceFunctionKMStructure(SEXP timeSEXP, SEXP statusSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type time(timeSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type status(statusSEXP);
+    rcpp_result_gen = Rcpp::wrap(getInfluenceFunctionKMStructure(time, status));
     return rcpp_result_gen;
 END_RCPP
 }
 // calcE_cpp
-List calcE_cpp(const NumericVector& eventtime, const NumericVector& status, const NumericVector& eXb, const arma::mat& X, int p, bool add0, bool reverse);
-RcppExport SEXP _riskRegression_calcE_cpp(SEXP eventtimeSEXP, SEXP statusSEXP, SEXP eXbSEXP, SEXP XSEXP, SEXP pSEXP, SEXP add0SEXP, SEXP reverseSEXP) {
+List calcE_cpp(const NumericVector& eventtime, const NumericVector& status, const NumericVector& eXb, const arma::mat& X, int p, bool add0, bool reverse, Nullable<IntegerVector> multiplicity);
+RcppExport SEXP _riskRegression_calcE_cpp(SEXP eventtimeSEXP, SEXP statusSEXP, SEXP eXbSEXP, SEXP XSEXP, SEXP pSEXP, SEXP add0SEXP, SEXP reverseSEXP, SEXP multiplicitySEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -339,7 +528,8 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< int >::type p(pSEXP);
     Rcpp::traits::input_parameter< bool >::type add0(add0SEXP);
     Rcpp::traits::input_parameter< bool >::type reverse(reverseSEXP);
-    rcpp_result_gen = Rcpp::wrap(calcE_cpp(eventtime, status, eXb, X, p, add0, reverse));
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type multiplicity(multiplicitySEXP);
+    rcpp_result_gen = Rcpp::wrap(calcE_cpp(eventtime, status, eXb, X, p, add0, reverse, multiplicity));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -390,8 +580,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // predictCIF_cpp
-List predictCIF_cpp(const std::vector<arma::mat>& hazard, const std::vector<arma::mat>& cumhazard, const arma::mat& eXb, const arma::mat& strata, const std::vector<double>& newtimes, const std::vector<double>& etimes, const std::vector<double>& etimeMax, double t0, int nEventTimes, int nNewTimes, int nData, int cause, int nCause, bool survtype, bool productLimit, bool diag, bool exportSurv);
-RcppExport SEXP _riskRegression_predictCIF_cpp(SEXP hazardSEXP, SEXP cumhazardSEXP, SEXP eXbSEXP, SEXP strataSEXP, SEXP newtimesSEXP, SEXP etimesSEXP, SEXP etimeMaxSEXP, SEXP t0SEXP, SEXP nEventTimesSEXP, SEXP nNewTimesSEXP, SEXP nDataSEXP, SEXP causeSEXP, SEXP nCauseSEXP, SEXP survtypeSEXP, SEXP productLimitSEXP, SEXP diagSEXP, SEXP exportSurvSEXP) {
+List predictCIF_cpp(const std::vector<arma::mat>& hazard, const std::vector<arma::mat>& cumhazard, const arma::mat& eXb, const arma::mat& strata, const std::vector<double>& newtimes, const std::vector<double>& etimes, const std::vector<double>& etimeMax, double t0, int nEventTimes, int nNewTimes, int nData, int cause, int nCause, bool survtype, bool productLimit, bool diag, bool exportSurv, Nullable<IntegerVector> index);
+RcppExport SEXP _riskRegression_predictCIF_cpp(SEXP hazardSEXP, SEXP cumhazardSEXP, SEXP eXbSEXP, SEXP strataSEXP, SEXP newtimesSEXP, SEXP etimesSEXP, SEXP etimeMaxSEXP, SEXP t0SEXP, SEXP nEventTimesSEXP, SEXP nNewTimesSEXP, SEXP nDataSEXP, SEXP causeSEXP, SEXP nCauseSEXP, SEXP survtypeSEXP, SEXP productLimitSEXP, SEXP diagSEXP, SEXP exportSurvSEXP, SEXP indexSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -412,18 +602,35 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type productLimit(productLimitSEXP);
     Rcpp::traits::input_parameter< bool >::type diag(diagSEXP);
     Rcpp::traits::input_parameter< bool >::type exportSurv(exportSurvSEXP);
-    rcpp_result_gen = Rcpp::wrap(predictCIF_cpp(hazard, cumhazard, eXb, strata, newtimes, etimes, etimeMax, t0, nEventTimes, nNewTimes, nData, cause, nCause, survtype, productLimit, diag, exportSurv));
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type index(indexSEXP);
+    rcpp_result_gen = Rcpp::wrap(predictCIF_cpp(hazard, cumhazard, eXb, strata, newtimes, etimes, etimeMax, t0, nEventTimes, nNewTimes, nData, cause, nCause, survtype, productLimit, diag, exportSurv, index));
     return rcpp_result_gen;
 END_RCPP
 }
 // rowCumSum
-NumericMatrix rowCumSum(NumericMatrix x);
-RcppExport SEXP _riskRegression_rowCumSum(SEXP xSEXP) {
+NumericMatrix rowCumSum(NumericMatrix x, bool inplace, int ncores);
+RcppExport SEXP _riskRegression_rowCumSum(SEXP xSEXP, SEXP inplaceSEXP, SEXP ncoresSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< NumericMatrix >::type x(xSEXP);
-    rcpp_result_gen = Rcpp::wrap(rowCumSum(x));
+    Rcpp::traits::input_parameter< bool >::type inplace(inplaceSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(rowCumSum(x, inplace, ncores));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rowCumSumIndex
+NumericVector rowCumSumIndex(NumericMatrix x, IntegerVector index, bool diag, int ncores);
+RcppExport SEXP _riskRegression_rowCumSumIndex(SEXP xSEXP, SEXP indexSEXP, SEXP diagSEXP, SEXP ncoresSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type x(xSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type index(indexSEXP);
+    Rcpp::traits::input_parameter< bool >::type diag(diagSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(rowCumSumIndex(x, index, diag, ncores));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -441,80 +648,133 @@ BEGIN_RCPP
 END_RCPP
 }
 // colCenter_cpp
-arma::mat colCenter_cpp(arma::mat X, const arma::colvec& center);
+NumericMatrix colCenter_cpp(const arma::mat& X, const arma::colvec& center);
 RcppExport SEXP _riskRegression_colCenter_cpp(SEXP XSEXP, SEXP centerSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< arma::mat >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type X(XSEXP);
     Rcpp::traits::input_parameter< const arma::colvec& >::type center(centerSEXP);
     rcpp_result_gen = Rcpp::wrap(colCenter_cpp(X, center));
     return rcpp_result_gen;
 END_RCPP
 }
 // rowCenter_cpp
-arma::mat rowCenter_cpp(arma::mat X, const arma::rowvec& center);
+NumericMatrix rowCenter_cpp(const arma::mat& X, const arma::rowvec& center);
 RcppExport SEXP _riskRegression_rowCenter_cpp(SEXP XSEXP, SEXP centerSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< arma::mat >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type X(XSEXP);
     Rcpp::traits::input_parameter< const arma::rowvec& >::type center(centerSEXP);
     rcpp_result_gen = Rcpp::wrap(rowCenter_cpp(X, center));
     return rcpp_result_gen;
 END_RCPP
 }
 // colScale_cpp
-arma::mat colScale_cpp(arma::mat X, const arma::colvec& scale);
+NumericMatrix colScale_cpp(const arma::mat& X, const arma::colvec& scale);
 RcppExport SEXP _riskRegression_colScale_cpp(SEXP XSEXP, SEXP scaleSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< arma::mat >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type X(XSEXP);
     Rcpp::traits::input_parameter< const arma::colvec& >::type scale(scaleSEXP);
     rcpp_result_gen = Rcpp::wrap(colScale_cpp(X, scale));
     return rcpp_result_gen;
 END_RCPP
 }
 // rowScale_cpp
-arma::mat rowScale_cpp(arma::mat X, const arma::rowvec& scale);
+NumericMatrix rowScale_cpp(const arma::mat& X, const arma::rowvec& scale);
 RcppExport SEXP _riskRegression_rowScale_cpp(SEXP XSEXP, SEXP scaleSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< arma::mat >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type X(XSEXP);
     Rcpp::traits::input_parameter< const arma::rowvec& >::type scale(scaleSEXP);
     rcpp_result_gen = Rcpp::wrap(rowScale_cpp(X, scale));
     return rcpp_result_gen;
 END_RCPP
 }
 // colMultiply_cpp
-arma::mat colMultiply_cpp(arma::mat X, const arma::colvec& scale);
+NumericMatrix colMultiply_cpp(const arma::mat& X, const arma::colvec& scale);
 RcppExport SEXP _riskRegression_colMultiply_cpp(SEXP XSEXP, SEXP scaleSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< arma::mat >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type X(XSEXP);
     Rcpp::traits::input_parameter< const arma::colvec& >::type scale(scaleSEXP);
     rcpp_result_gen = Rcpp::wrap(colMultiply_cpp(X, scale));
     return rcpp_result_gen;
 END_RCPP
 }
 // rowMultiply_cpp
-arma::mat rowMultiply_cpp(arma::mat X, const arma::rowvec& scale);
+NumericMatrix rowMultiply_cpp(const arma::mat& X, const arma::rowvec& scale);
 RcppExport SEXP _riskRegression_rowMultiply_cpp(SEXP XSEXP, SEXP scaleSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< arma::mat >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type X(XSEXP);
     Rcpp::traits::input_parameter< const arma::rowvec& >::type scale(scaleSEXP);
     rcpp_result_gen = Rcpp::wrap(rowMultiply_cpp(X, scale));
     return rcpp_result_gen;
 END_RCPP
 }
+// colCenterScale_cpp
+NumericMatrix colCenterScale_cpp(const arma::mat& X, const arma::colvec& center, const arma::colvec& scale);
+RcppExport SEXP _riskRegression_colCenterScale_cpp(SEXP XSEXP, SEXP centerSEXP, SEXP scaleSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const arma::colvec& >::type center(centerSEXP);
+    Rcpp::traits::input_parameter< const arma::colvec& >::type scale(scaleSEXP);
+    rcpp_result_gen = Rcpp::wrap(colCenterScale_cpp(X, center, scale));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rowCenterScale_cpp
+NumericMatrix rowCenterScale_cpp(const arma::mat& X, const arma::rowvec& center, const arma::rowvec& scale);
+RcppExport SEXP _riskRegression_rowCenterScale_cpp(SEXP XSEXP, SEXP centerSEXP, SEXP scaleSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const arma::rowvec& >::type center(centerSEXP);
+    Rcpp::traits::input_parameter< const arma::rowvec& >::type scale(scaleSEXP);
+    rcpp_result_gen = Rcpp::wrap(rowCenterScale_cpp(X, center, scale));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rowMultiplySum_cpp
+NumericVector rowMultiplySum_cpp(NumericMatrix X, NumericVector scale, bool mean, int ncores);
+RcppExport SEXP _riskRegression_rowMultiplySum_cpp(SEXP XSEXP, SEXP scaleSEXP, SEXP meanSEXP, SEXP ncoresSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type X(XSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type scale(scaleSEXP);
+    Rcpp::traits::input_parameter< bool >::type mean(meanSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(rowMultiplySum_cpp(X, scale, mean, ncores));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sliceRowMultiplySum_cpp
+NumericVector sliceRowMultiplySum_cpp(NumericVector X, int col, NumericVector scale, bool mean, int ncores);
+RcppExport SEXP _riskRegression_sliceRowMultiplySum_cpp(SEXP XSEXP, SEXP colSEXP, SEXP scaleSEXP, SEXP meanSEXP, SEXP ncoresSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type X(XSEXP);
+    Rcpp::traits::input_parameter< int >::type col(colSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type scale(scaleSEXP);
+    Rcpp::traits::input_parameter< bool >::type mean(meanSEXP);
+    Rcpp::traits::input_parameter< int >::type ncores(ncoresSEXP);
+    rcpp_result_gen = Rcpp::wrap(sliceRowMultiplySum_cpp(X, col, scale, mean, ncores));
+    return rcpp_result_gen;
+END_RCPP
+}
 // weightedAverageIFCumhazard_cpp
-NumericVector weightedAverageIFCumhazard_cpp(const arma::vec& seqTau, const std::vector< arma::vec >& cumhazard0, const arma::mat& newX, const arma::vec& neweXb, const arma::mat& IFbeta, const std::vector< arma::mat >& cumEhazard0, const std::vector< arma::vec >& cumhazard_iS0, const arma::mat& delta_iS0, const arma::mat& sample_eXb, const arma::vec& sample_time, const std::vector< arma::uvec>& indexJumpSample_time, const std::vector< arma::vec>& jump_time, const std::vector< arma::uvec >& indexJumpTau, const arma::vec& lastSampleTime, const std::vector< arma::uvec>& newdata_index, int nTau, int nSample, int nStrata, int p, bool diag, int debug, const arma::vec& weights, bool isBeforeTau, double tau);
-RcppExport SEXP _riskRegression_weightedAverageIFCumhazard_cpp(SEXP seqTauSEXP, SEXP cumhazard0SEXP, SEXP newXSEXP, SEXP neweXbSEXP, SEXP IFbetaSEXP, SEXP cumEhazard0SEXP, SEXP cumhazard_iS0SEXP, SEXP delta_iS0SEXP, SEXP sample_eXbSEXP, SEXP sample_timeSEXP, SEXP indexJumpSample_timeSEXP, SEXP jump_timeSEXP, SEXP indexJumpTauSEXP, SEXP lastSampleTimeSEXP, SEXP newdata_indexSEXP, SEXP nTauSEXP, SEXP nSampleSEXP, SEXP nStrataSEXP, SEXP pSEXP, SEXP diagSEXP, SEXP debugSEXP, SEXP weightsSEXP, SEXP isBeforeTauSEXP, SEXP tauSEXP) {
+NumericVector weightedAverageIFCumhazard_cpp(const arma::vec& seqTau, const std::vector< arma::vec >& cumhazard0, const arma::mat& newX, const arma::vec& neweXb, const arma::mat& IFbeta, const std::vector< arma::mat >& cumEhazard0, const std::vector< arma::vec >& cumhazard_iS0, const arma::mat& delta_iS0, const arma::mat& sample_eXb, const arma::vec& sample_time, const std::vector< arma::uvec>& indexJumpSample_time, const std::vector< arma::vec>& jump_time, const std::vector< arma::uvec >& indexJumpTau, const arma::vec& lastSampleTime, const std::vector< arma::uvec>& newdata_index, int nTau, int nSample, int nStrata, int p, bool diag, int debug, const arma::vec& weights, bool isBeforeTau, double tau, bool firsthit, bool reduceFirst);
+RcppExport SEXP _riskRegression_weightedAverageIFCumhazard_cpp(SEXP seqTauSEXP, SEXP cumhazard0SEXP, SEXP newXSEXP, SEXP neweXbSEXP, SEXP IFbetaSEXP, SEXP cumEhazard0SEXP, SEXP cumhazard_iS0SEXP, SEXP delta_iS0SEXP, SEXP sample_eXbSEXP, SEXP sample_timeSEXP, SEXP indexJumpSample_timeSEXP, SEXP jump_timeSEXP, SEXP indexJumpTauSEXP, SEXP lastSampleTimeSEXP, SEXP newdata_indexSEXP, SEXP nTauSEXP, SEXP nSampleSEXP, SEXP nStrataSEXP, SEXP pSEXP, SEXP diagSEXP, SEXP debugSEXP, SEXP weightsSEXP, SEXP isBeforeTauSEXP, SEXP tauSEXP, SEXP firsthitSEXP, SEXP reduceFirstSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -542,31 +802,45 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const arma::vec& >::type weights(weightsSEXP);
     Rcpp::traits::input_parameter< bool >::type isBeforeTau(isBeforeTauSEXP);
     Rcpp::traits::input_parameter< double >::type tau(tauSEXP);
-    rcpp_result_gen = Rcpp::wrap(weightedAverageIFCumhazard_cpp(seqTau, cumhazard0, newX, neweXb, IFbeta, cumEhazard0, cumhazard_iS0, delta_iS0, sample_eXb, sample_time, indexJumpSample_time, jump_time, indexJumpTau, lastSampleTime, newdata_index, nTau, nSample, nStrata, p, diag, debug, weights, isBeforeTau, tau));
+    Rcpp::traits::input_parameter< bool >::type firsthit(firsthitSEXP);
+    Rcpp::traits::input_parameter< bool >::type reduceFirst(reduceFirstSEXP);
+    rcpp_result_gen = Rcpp::wrap(weightedAverageIFCumhazard_cpp(seqTau, cumhazard0, newX, neweXb, IFbeta, cumEhazard0, cumhazard_iS0, delta_iS0, sample_eXb, sample_time, indexJumpSample_time, jump_time, indexJumpTau, lastSampleTime, newdata_index, nTau, nSample, nStrata, p, diag, debug, weights, isBeforeTau, tau, firsthit, reduceFirst));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
     {"_riskRegression_aucLoobFun", (DL_FUNC) &_riskRegression_aucLoobFun, 5},
-    {"_riskRegression_baseHaz_cpp", (DL_FUNC) &_riskRegression_baseHaz_cpp, 12},
+    {"_riskRegression_getOobBits", (DL_FUNC) &_riskRegression_getOobBits, 4},
+    {"_riskRegression_countOobBits", (DL_FUNC) &_riskRegression_countOobBits, 1},
+    {"_riskRegression_aucLoobBitFun", (DL_FUNC) &_riskRegression_aucLoobBitFun, 6},
+    {"_riskRegression_baseHaz_cpp", (DL_FUNC) &_riskRegression_baseHaz_cpp, 13},
+    {"_riskRegression_ipcw_cpp", (DL_FUNC) &_riskRegression_ipcw_cpp, 8},
     {"_riskRegression_calcSeMinimalCSC_cpp", (DL_FUNC) &_riskRegression_calcSeMinimalCSC_cpp, 36},
     {"_riskRegression_calcSeCif2_cpp", (DL_FUNC) &_riskRegression_calcSeCif2_cpp, 25},
-    {"_riskRegression_calcSeMinimalCox_cpp", (DL_FUNC) &_riskRegression_calcSeMinimalCox_cpp, 33},
+    {"_riskRegression_calcSeMinimalCox_cpp", (DL_FUNC) &_riskRegression_calcSeMinimalCox_cpp, 34},
     {"_riskRegression_calcAIFsurv_cpp", (DL_FUNC) &_riskRegression_calcAIFsurv_cpp, 17},
-    {"_riskRegression_calculateDelongCovarianceFast", (DL_FUNC) &_riskRegression_calculateDelongCovarianceFast, 2},
-    {"_riskRegression_colCumSum", (DL_FUNC) &_riskRegression_colCumSum, 1},
-    {"_riskRegression_quantileProcess_cpp", (DL_FUNC) &_riskRegression_quantileProcess_cpp, 7},
-    {"_riskRegression_pProcess_cpp", (DL_FUNC) &_riskRegression_pProcess_cpp, 8},
-    {"_riskRegression_sampleMaxProcess_cpp", (DL_FUNC) &_riskRegression_sampleMaxProcess_cpp, 8},
-    {"_riskRegression_getIC0AUC", (DL_FUNC) &_riskRegression_getIC0AUC, 7},
-    {"_riskRegression_getInfluenceFunctionAUCKMCensoringTerm", (DL_FUNC) &_riskRegression_getInfluenceFunctionAUCKMCensoringTerm, 13},
-    {"_riskRegression_getInfluenceFunctionBrierKMCensoringTerm", (DL_FUNC) &_riskRegression_getInfluenceFunctionBrierKMCensoringTerm, 4},
-    {"_riskRegression_calcE_cpp", (DL_FUNC) &_riskRegression_calcE_cpp, 7},
+    {"_riskRegression_calculateDelongCovarianceFast", (DL_FUNC) &_riskRegression_calculateDelongCovarianceFast, 3},
+    {"_riskRegression_calculateDelongCovarianceWeighted", (DL_FUNC) &_riskRegression_calculateDelongCovarianceWeighted, 7},
+    {"_riskRegression_colCumSum", (DL_FUNC) &_riskRegression_colCumSum, 3},
+    {"_riskRegression_quantileProcess_cpp", (DL_FUNC) &_riskRegression_quantileProcess_cpp, 11},
+    {"_riskRegression_pProcess_cpp", (DL_FUNC) &_riskRegression_pProcess_cpp, 11},
+    {"_riskRegression_pProcessAdaptive_cpp", (DL_FUNC) &_riskRegression_pProcessAdaptive_cpp, 12},
+    {"_riskRegression_sampleMaxProcess_cpp", (DL_FUNC) &_riskRegression_sampleMaxProcess_cpp, 11},
+    {"_riskRegression_simulateProcess_cpp", (DL_FUNC) &_riskRegression_simulateProcess_cpp, 11},
+    {"_riskRegression_lowRankProcess_cpp", (DL_FUNC) &_riskRegression_lowRankProcess_cpp, 3},
+    {"_riskRegression_getIC0AUC", (DL_FUNC) &_riskRegression_getIC0AUC, 8},
+    {"_riskRegression_getInfluenceFunctionAUCKMCensoringTerm", (DL_FUNC) &_riskRegression_getInfluenceFunctionAUCKMCensoringTerm, 14},
+    {"_riskRegression_getInfluenceFunctionAUCKM", (DL_FUNC) &_riskRegression_getInfluenceFunctionAUCKM, 9},
+    {"_riskRegression_getInfluenceFunctionBrierKMCensoringTerm", (DL_FUNC) &_riskRegression_getInfluenceFunctionBrierKMCensoringTerm, 5},
+    {"_riskRegression_getInfluenceFunctionBrierKMCensoringTermMultipleTimes", (DL_FUNC) &_riskRegression_getInfluenceFunctionBrierKMCensoringTermMultipleTimes, 5},
+    {"_riskRegression_getInfluenceFunctionKMStructure", (DL_FUNC) &_riskRegression_getInfluenceFunctionKMStructure, 2},
+    {"_riskRegression_calcE_cpp", (DL_FUNC) &_riskRegression_calcE_cpp, 8},
     {"_riskRegression_IFbeta_cpp", (DL_FUNC) &_riskRegression_IFbeta_cpp, 10},
     {"_riskRegression_IFlambda0_cpp", (DL_FUNC) &_riskRegression_IFlambda0_cpp, 16},
-    {"_riskRegression_predictCIF_cpp", (DL_FUNC) &_riskRegression_predictCIF_cpp, 17},
-    {"_riskRegression_rowCumSum", (DL_FUNC) &_riskRegression_rowCumSum, 1},
+    {"_riskRegression_predictCIF_cpp", (DL_FUNC) &_riskRegression_predictCIF_cpp, 18},
+    {"_riskRegression_rowCumSum", (DL_FUNC) &_riskRegression_rowCumSum, 3},
+    {"_riskRegression_rowCumSumIndex", (DL_FUNC) &_riskRegression_rowCumSumIndex, 4},
     {"_riskRegression_rowSumsCrossprod", (DL_FUNC) &_riskRegression_rowSumsCrossprod, 3},
     {"_riskRegression_colCenter_cpp", (DL_FUNC) &_riskRegression_colCenter_cpp, 2},
     {"_riskRegression_rowCenter_cpp", (DL_FUNC) &_riskRegression_rowCenter_cpp, 2},
@@ -574,7 +848,11 @@ static const R_CallMethodDef CallEntries[] = {
     {"_riskRegression_rowScale_cpp", (DL_FUNC) &_riskRegression_rowScale_cpp, 2},
     {"_riskRegression_colMultiply_cpp", (DL_FUNC) &_riskRegression_colMultiply_cpp, 2},
     {"_riskRegression_rowMultiply_cpp", (DL_FUNC) &_riskRegression_rowMultiply_cpp, 2},
-    {"_riskRegression_weightedAverageIFCumhazard_cpp", (DL_FUNC) &_riskRegression_weightedAverageIFCumhazard_cpp, 24},
+    {"_riskRegression_colCenterScale_cpp", (DL_FUNC) &_riskRegression_colCenterScale_cpp, 3},
+    {"_riskRegression_rowCenterScale_cpp", (DL_FUNC) &_riskRegression_rowCenterScale_cpp, 3},
+    {"_riskRegression_rowMultiplySum_cpp", (DL_FUNC) &_riskRegression_rowMultiplySum_cpp, 4},
+    {"_riskRegression_sliceRowMultiplySum_cpp", (DL_FUNC) &_riskRegression_sliceRowMultiplySum_cpp, 5},
+    {"_riskRegression_weightedAverageIFCumhazard_cpp", (DL_FUNC) &_riskRegression_weightedAverageIFCumhazard_cpp, 26},
     {NULL, NULL, 0}
 };
 
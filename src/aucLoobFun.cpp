@@ -1,6 +1,17 @@
 #include "Rcpp.h"
+#include <algorithm>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 using namespace Rcpp;
 
+std::vector<uint64_t> unpackOobBits(const NumericMatrix& oobBits);
+inline int popcount64(uint64_t x);
+inline int ctz64(uint64_t x);
+
 // [[Rcpp::export]]
 List aucLoobFun(IntegerVector IDCase, IntegerVector IDControl, NumericMatrix riskMat, LogicalMatrix splitMat, NumericVector weights){
   int nCases = IDCase.length();
@@ -39,3 +50,143 @@ List aucLoobFun(IntegerVector IDCase, IntegerVector IDControl, NumericMatrix ris
                       Named("ic0Case") = ic0Case,
                       Named("ic0Control") = ic0Control));
 }
+
+// Bit-packed out-of-bag membership: column i of the output contains
+// ceil(B/64) words of 64 bits and bit b is set when subject i is
+// out-of-bag in bootstrap b. The words are stored in the 8 bytes of a
+// double, so that they can be kept on the R side.
+// ID and bootstrap are the (R indexed) subject and bootstrap of each out-of-bag prediction.
+// [[Rcpp::export(rng = false)]]
+NumericMatrix getOobBits(IntegerVector ID, IntegerVector bootstrap, int N, int B){
+  int nWords = (B+63)/64;
+  std::vector<uint64_t> bits((size_t) nWords * N, 0);
+  int n = ID.length();
+  if (bootstrap.length() != n) stop("ID and bootstrap must have the same length.");
+  for (int k = 0; k < n; k++){
+    int i = ID[k]-1, b = bootstrap[k]-1; // R indexing to C++ indexing.
+    if (i < 0 || i >= N || b < 0 || b >= B) stop("ID or bootstrap out of range.");
+    bits[(size_t) nWords * i + b/64] |= ((uint64_t) 1) << (b % 64);
+  }
+  NumericMatrix out(nWords,N);
+  if (bits.size()>0) std::memcpy(out.begin(),bits.data(),bits.size()*sizeof(uint64_t));
+  out.attr("B") = B;
+  return(out);
+}
+
+// Number of bootstraps where each subject is out-of-bag
+// [[Rcpp::export(rng = false)]]
+IntegerVector countOobBits(NumericMatrix oobBits){
+  int nWords = oobBits.nrow();
+  int N = oobBits.ncol();
+  std::vector<uint64_t> bits = unpackOobBits(oobBits);
+  IntegerVector out(N);
+  for (int i = 0; i < N; i++){
+    for (int w = 0; w < nWords; w++){
+      out[i] += popcount64(bits[(size_t) nWords * i + w]);
+    }
+  }
+  return(out);
+}
+
+// Same as aucLoobFun but with bit-packed out-of-bag membership (see getOobBits).
+// The number of bootstraps where both subjects are out-of-bag is a popcount of the
+// AND of their words and only these bootstraps are visited.
+// Cases are distributed over ncores threads (when compiled with OpenMP).
+// [[Rcpp::export(rng = false)]]
+List aucLoobBitFun(IntegerVector IDCase, IntegerVector IDControl, NumericMatrix riskMat, NumericMatrix oobBits, NumericVector weights, int ncores = 1){
+  int nCases = IDCase.length();
+  int nControls = IDControl.length();
+  int N = riskMat.nrow();
+  int nWords = oobBits.nrow();
+  if (!oobBits.hasAttribute("B")) stop("oobBits must be created by getOobBits.");
+  int B = as<int>(oobBits.attr("B"));
+  if (oobBits.ncol() != N || riskMat.ncol() != B || nWords != (B+63)/64) stop("oobBits does not match the dimension of riskMat.");
+  std::vector<uint64_t> bits = unpackOobBits(oobBits);
+  const double* risk = riskMat.begin();
+  std::vector<int> idCase(nCases), idControl(nControls);
+  for (int i = 0; i < nCases; i++) idCase[i] = IDCase[i]-1; // R indexing to C++ indexing.
+  for (int j = 0; j < nControls; j++) idControl[j] = IDControl[j]-1; // R indexing to C++ indexing.
+  NumericVector ic0Case(nCases);
+  NumericVector ic0Control(nControls);
+  std::vector<double> sumCase(nCases,0.0), sumControl(nControls,0.0);
+  bool warn = false;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(ncores > 0 ? ncores : 1)
+#endif
+  {
+    std::vector<double> localControl(nControls,0.0);
+    bool localWarn = false;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (int i = 0; i < nCases; i++){
+      const uint64_t* bitsCase = bits.data() + (size_t) nWords * idCase[i];
+      for (int j = 0; j < nControls; j++){
+        const uint64_t* bitsControl = bits.data() + (size_t) nWords * idControl[j];
+        int ibij = 0;
+        double aucij = 0;
+        for (int w = 0; w < nWords; w++){
+          uint64_t both = bitsCase[w] & bitsControl[w];
+          ibij += popcount64(both);
+          while (both){
+            size_t b = 64*w + ctz64(both);
+            both &= both - 1; // clear lowest set bit
+            double riskCase = risk[idCase[i] + N * b], riskControl = risk[idControl[j] + N * b];
+            if (riskCase > riskControl){
+              aucij += 1.0;
+            }
+            else if (riskCase == riskControl){
+              aucij+=0.5;
+            }
+          }
+        }
+        if (ibij == 0){ // the pair is not oob
+          localWarn = true;
+        }
+        else {
+          double ic0ij = weights[idCase[i]]*weights[idControl[j]]*aucij / ((double) ibij);
+          sumCase[i] += ic0ij;
+          localControl[j] += ic0ij;
+        }
+      }
+    }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    {
+      for (int j = 0; j < nControls; j++) sumControl[j] += localControl[j];
+      warn = warn || localWarn;
+    }
+  }
+  std::copy(sumCase.begin(),sumCase.end(),ic0Case.begin());
+  std::copy(sumControl.begin(),sumControl.end(),ic0Control.begin());
+  return(List::create(Named("warn") = warn,
+                      Named("ic0Case") = ic0Case,
+                      Named("ic0Control") = ic0Control));
+}
+
+std::vector<uint64_t> unpackOobBits(const NumericMatrix& oobBits){
+  std::vector<uint64_t> bits((size_t) oobBits.nrow() * oobBits.ncol());
+  if (bits.size()>0) std::memcpy(bits.data(),oobBits.begin(),bits.size()*sizeof(uint64_t));
+  return(bits);
+}
+
+inline int popcount64(uint64_t x){
+#if defined(__GNUC__) || defined(__clang__)
+  return(__builtin_popcountll(x));
+#else
+  int n = 0;
+  while (x){ x &= x - 1; n++; }
+  return(n);
+#endif
+}
+
+inline int ctz64(uint64_t x){
+#if defined(__GNUC__) || defined(__clang__)
+  return(__builtin_ctzll(x));
+#else
+  int n = 0;
+  while (!(x & 1)){ x >>= 1; n++; }
+  return(n);
+#endif
+}
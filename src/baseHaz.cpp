@@ -1,5 +1,6 @@
 // [[Rcpp::depends(RcppArmadillo)]]
 #include <RcppArmadillo.h>
+#include <algorithm>
 
 using namespace Rcpp;
 using namespace std;
@@ -42,6 +43,11 @@ structExport subset_structExport(const structExport& resAll,
 //' @param cause the status value corresponding to event.
 //' @param Efron whether Efron or Breslow estimator should be used in presence of ties.
 //' @param reverse whether censoring occurs before events in presence of ties.
+//' @param multiplicity [optional] number of times each observation should be counted,
+//' e.g. its number of occurrences in a bootstrap sample (0 if not sampled).
+//' Enables to compute the baseline hazard of a resampled dataset without forming it in R.
+//' The per strata buffers used by the C++ code still contain each observation repeated according to its multiplicity,
+//' i.e. one copy of the resampled dataset is made for each call.
 //' 
 //' @details WARNING stoptimes status eXb and strata must be sorted by strata, stoptimes, and status
 //' @export
@@ -57,7 +63,8 @@ List baseHaz_cpp(const NumericVector& starttimes,
                  int nStrata,
                  int cause,
                  bool Efron,
-		 bool reverse){
+		 bool reverse,
+		 Nullable<IntegerVector> multiplicity = R_NilValue){
   
   vector<int> nObsStrata(nStrata,0);
   vector< vector<double> > starttimes_S(nStrata);
@@ -72,8 +79,40 @@ List baseHaz_cpp(const NumericVector& starttimes,
     max_predtimes = predtimes[nPredtimes-1];
   }
   
+  ////// 0- Resampling (each observation is repeated according to its multiplicity)
+  if(multiplicity.isNotNull()){
+    IntegerVector nRep(multiplicity);
+    if(nRep.size() != nPatients){
+      stop("Argument \'multiplicity\' should have length %i (number of observations). \n", nPatients);
+    }
+    vector<int> index_tempo(nStrata,0);
+    for(int iter_p = 0 ; iter_p < nPatients ; iter_p++){
+      if(nRep[iter_p] == NA_INTEGER || nRep[iter_p] < 0){
+	stop("Argument \'multiplicity\' should only contain non-negative integers. \n");
+      }
+      nObsStrata[(nStrata == 1) ? 0 : strata[iter_p]] += nRep[iter_p];
+    }
+    for(int iter_s = 0 ; iter_s < nStrata ; iter_s++){
+      starttimes_S[iter_s].reserve(nObsStrata[iter_s]);
+      stoptimes_S[iter_s].reserve(nObsStrata[iter_s]);
+      status_S[iter_s].reserve(nObsStrata[iter_s]);
+      eXb_S[iter_s].reserve(nObsStrata[iter_s]);
+      index_S[iter_s].set_size(nObsStrata[iter_s]);
+    }
+    for(int iter_p = 0 ; iter_p < nPatients ; iter_p++){
+      int strata_tempo = (nStrata == 1) ? 0 : strata[iter_p];
+      starttimes_S[strata_tempo].insert(starttimes_S[strata_tempo].end(), nRep[iter_p], starttimes[iter_p]);
+      stoptimes_S[strata_tempo].insert(stoptimes_S[strata_tempo].end(), nRep[iter_p], stoptimes[iter_p]);
+      status_S[strata_tempo].insert(status_S[strata_tempo].end(), nRep[iter_p], status[iter_p]);
+      eXb_S[strata_tempo].insert(eXb_S[strata_tempo].end(), nRep[iter_p], eXb[iter_p]);
+      for(int iRep = 0 ; iRep < nRep[iter_p] ; iRep++){
+	index_S[strata_tempo][index_tempo[strata_tempo]] = index_tempo[strata_tempo];
+	index_tempo[strata_tempo]++;
+      }
+    }
+
   ////// 1- Strata  
-  if(nStrata == 1){
+  }else if(nStrata == 1){
     
     nObsStrata[0] = nPatients;
     starttimes_S[0].resize(nPatients);
@@ -129,6 +168,16 @@ List baseHaz_cpp(const NumericVector& starttimes,
   
   for(int iter_s = 0 ; iter_s < nStrata ; iter_s++){
     R_CheckUserInterrupt();
+
+    if(nObsStrata[iter_s] == 0){ // empty strata (e.g. not sampled): hazard cannot be estimated
+      if(nPredtimes>0){
+	timeRes.insert( timeRes.end(), predtimes.begin(), predtimes.end() );
+	hazardRes.resize( hazardRes.size() + nPredtimes, NA_REAL);
+	cumhazardRes.resize( cumhazardRes.size() + nPredtimes, NA_REAL);
+	strataRes.resize( strataRes.size() + nPredtimes, iter_s);
+      }
+      continue;
+    }
     
     if(nPredtimes>0){ // set maxtime to the first event after the maximum prediction time
       int i = 0;
@@ -170,6 +219,169 @@ List baseHaz_cpp(const NumericVector& starttimes,
 }
 
 
+// * ipcw_cpp
+// Inverse probability of censoring weights from the reverse product limit estimator (eXb=1)
+// or from a Cox model for the censoring times (eXb: exponential of its linear predictor), possibly stratified.
+// The baseline hazard of censoring is obtained with baseHazStrata_cpp(reverse=TRUE),
+// i.e. at ties events are assumed to occur before censoring.
+// Returns G(t|X) at the horizons and G(T_i-|X_i), where G(t|X)=S0(t)^eXb and S0 is either the product limit
+// (productLimit=true) or the exponential of minus the cumulative hazard (productLimit=false).
+//
+// time, status (0 = censored), eXb, and strata (starting at 0) describe the dataset which must be sorted by time.
+// When index is not NULL, the computations are performed for the dataset data[index,] (index starts at 1 as in R)
+// without copying it, e.g. a bootstrap sample. The output rows then follow the order of index.
+// [[Rcpp::export(rng = false)]]
+List ipcw_cpp(const NumericVector& time,
+			  const IntegerVector& status,
+			  const NumericVector& eXb,
+			  const IntegerVector& strata,
+			  int nStrata,
+			  const std::vector<double>& times,
+			  Nullable<IntegerVector> index = R_NilValue,
+			  bool productLimit = true){
+
+  int n = time.size();
+  int nTimes = times.size();
+  if(status.size() != n || eXb.size() != n || strata.size() != n){
+	stop("Arguments \'time\', \'status\', \'eXb\', and \'strata\' should have the same length. \n");
+  }
+  for(int iObs = 1 ; iObs < n ; iObs++){
+	if(time[iObs] < time[iObs-1]){
+	  stop("Argument \'time\' should be sorted in increasing order. \n");
+	}
+  }
+
+  //// 1- multiplicity of each observation in the (resampled) dataset
+  vector<int> multiplicity(n,1);
+  IntegerVector indexObs;
+  if(index.isNotNull()){
+	indexObs = IntegerVector(index);
+	std::fill(multiplicity.begin(), multiplicity.end(), 0);
+	for(int iK = 0 ; iK < indexObs.size() ; iK++){
+	  if(indexObs[iK] == NA_INTEGER || indexObs[iK] < 1 || indexObs[iK] > n){
+		stop("Argument \'index\' should contain integers between 1 and %i (number of observations). \n", n);
+	  }
+	  multiplicity[indexObs[iK]-1]++;
+	}
+  }
+  int nOut = index.isNotNull() ? indexObs.size() : n;
+
+  //// 2- dataset per strata (repeated according to the multiplicity, already sorted by time)
+  vector<int> nObsStrata(nStrata,0);
+  for(int iObs = 0 ; iObs < n ; iObs++){
+	if(strata[iObs] < 0 || strata[iObs] >= nStrata){
+	  stop("Argument \'strata\' should contain integers between 0 and %i. \n", nStrata-1);
+	}
+	nObsStrata[strata[iObs]] += multiplicity[iObs];
+  }
+  vector< vector<double> > stoptimes_S(nStrata);
+  vector< vector<int> > status_S(nStrata);
+  vector< vector<double> > eXb_S(nStrata);
+  for(int iter_s = 0 ; iter_s < nStrata ; iter_s++){
+	stoptimes_S[iter_s].reserve(nObsStrata[iter_s]);
+	status_S[iter_s].reserve(nObsStrata[iter_s]);
+	eXb_S[iter_s].reserve(nObsStrata[iter_s]);
+  }
+  // within tied times, events are stored before censored observations (as expected by baseHazStrata_cpp)
+  int iStart = 0;
+  while(iStart < n){
+	int iEnd = iStart;
+	while(iEnd < n && time[iEnd] == time[iStart]){
+	  iEnd++;
+	}
+	for(int iCensored = 0 ; iCensored <= 1 ; iCensored++){
+	  for(int iObs = iStart ; iObs < iEnd ; iObs++){
+		if((int)(status[iObs]==0) != iCensored){
+		  continue;
+		}
+		int iStrata = strata[iObs];
+		stoptimes_S[iStrata].insert(stoptimes_S[iStrata].end(), multiplicity[iObs], time[iObs]);
+		status_S[iStrata].insert(status_S[iStrata].end(), multiplicity[iObs], iCensored); // censoring is the event
+		eXb_S[iStrata].insert(eXb_S[iStrata].end(), multiplicity[iObs], eXb[iObs]);
+	  }
+	}
+	iStart = iEnd;
+  }
+
+  //// 3- baseline survival of the censoring times in each strata
+  // at the horizons (NA after the last observation of the strata) and just before each observation time
+  vector< vector<double> > survTimes(nStrata, vector<double>(nTimes, NA_REAL));
+  vector<double> survSubjectTimes(n, NA_REAL);
+  vector<int> iPos(nStrata,0); // position of the current observation time in the strata-specific time grid
+  vector<double> iSurvBefore(nStrata,1.0); // baseline survival just before the current observation time
+  vector< vector<double> > surv0(nStrata);
+  vector< vector<double> > time0(nStrata);
+  vector<int> orderTimes(nTimes);
+  for(int iTau = 0 ; iTau < nTimes ; iTau++){
+	orderTimes[iTau] = iTau;
+  }
+  std::stable_sort(orderTimes.begin(), orderTimes.end(), [&times](int i, int j){ return times[i] < times[j]; });
+
+  for(int iter_s = 0 ; iter_s < nStrata ; iter_s++){
+	R_CheckUserInterrupt();
+	if(nObsStrata[iter_s] == 0){
+	  continue;
+	}
+	vector<double> starttimes_S(nObsStrata[iter_s], 0.0);
+	structExport resH = baseHazStrata_cpp(starttimes_S, stoptimes_S[iter_s], status_S[iter_s], eXb_S[iter_s],
+										  nObsStrata[iter_s], stoptimes_S[iter_s].back(), 1,
+										  false, true);
+	time0[iter_s] = resH.time;
+	surv0[iter_s].resize(resH.n);
+	double survTempo = 1.0;
+	for(int iTime = 0 ; iTime < resH.n ; iTime++){
+	  if(productLimit){
+		survTempo *= (1 - resH.hazard[iTime]);
+	  }else{
+		survTempo = exp(-resH.cumhazard[iTime]);
+	  }
+	  surv0[iter_s][iTime] = survTempo;
+	}
+
+	// horizons (visited in increasing order)
+	int iTime = -1;
+	for(int iTau = 0 ; iTau < nTimes ; iTau++){
+	  double iHorizon = times[orderTimes[iTau]];
+	  if(iHorizon > resH.time[resH.n-1]){
+		break;
+	  }
+	  while(iTime < (resH.n-1) && resH.time[iTime+1] <= iHorizon){
+		iTime++;
+	  }
+	  survTimes[iter_s][orderTimes[iTau]] = (iTime < 0) ? 1.0 : surv0[iter_s][iTime];
+	}
+  }
+
+  // observation times (sorted): survival at the last time of the strata-specific grid strictly before the observation time
+  for(int iObs = 0 ; iObs < n ; iObs++){
+	int iStrata = strata[iObs];
+	if(multiplicity[iObs] == 0){
+	  continue;
+	}
+	while(time0[iStrata][iPos[iStrata]] < time[iObs]){
+	  iSurvBefore[iStrata] = surv0[iStrata][iPos[iStrata]];
+	  iPos[iStrata]++;
+	}
+	survSubjectTimes[iObs] = iSurvBefore[iStrata];
+  }
+
+  //// 4- export
+  NumericMatrix IPCWtimes(nOut, nTimes);
+  NumericVector IPCWsubjectTimes(nOut);
+  for(int iOut = 0 ; iOut < nOut ; iOut++){
+	int iObs = index.isNotNull() ? indexObs[iOut]-1 : iOut;
+	double iExb = eXb[iObs];
+	for(int iTau = 0 ; iTau < nTimes ; iTau++){
+	  double iSurv = survTimes[strata[iObs]][iTau];
+	  IPCWtimes(iOut,iTau) = (iExb == 1.0 || R_IsNA(iSurv)) ? iSurv : pow(iSurv, iExb);
+	}
+	IPCWsubjectTimes[iOut] = (iExb == 1.0) ? survSubjectTimes[iObs] : pow(survSubjectTimes[iObs], iExb);
+  }
+
+  return(List::create(Named("IPCW.times") = IPCWtimes,
+					  Named("IPCW.subject.times") = IPCWsubjectTimes));
+}
+
 // * baseHazStrata_cpp
 structExport baseHazStrata_cpp(const vector<double>& starttimes,
 			       const vector<double>& stoptimes,
@@ -4,6 +4,8 @@
 using namespace Rcpp;
 using namespace std;
 
+arma::uvec findProfile_cpp(const arma::mat& key);
+
 // * calcSeMinimalCSC_cpp: compute IF/sumIF/se for the cif (method 1)
 // J: number of jump times
 // n: number of observations in the training set
@@ -62,7 +64,23 @@ List calcSeMinimalCSC_cpp(const arma::vec& seqTau, // horizon time for the predi
 
   arma::vec iStrata_factor, iStrata_wSeXb1,iStrata_wSeXb1eXbj;
   arma::mat iStrata_wSeXb1X1,iStrata_wSeXb1eXbjXj;
+
+  arma::uvec iStrata_profile, iStrata_indexProfile;
+  std::vector< arma::mat > iStrata_factorProfile(nFactor);
   
+  // ** covariate profiles
+  // within a strata, observations with the same linear predictors and design matrices (and prediction time when diag)
+  // have the same influence function: it is only computed for the first observation of each profile
+  arma::mat profile_key = neweXb;
+  for(int iCause=0; iCause<nCause; iCause++){
+	if(p(iCause)>0){
+	  profile_key = arma::join_rows(profile_key, newX[iCause]);
+	}
+  }
+  if(diag){
+	profile_key = arma::join_rows(profile_key, seqTau);
+  }
+
   // ** initialize
   if(debug>0){Rcpp::Rcout << "Initialize" << std::endl;}
   arma::cube IF_cif;
@@ -142,6 +160,18 @@ List calcSeMinimalCSC_cpp(const arma::vec& seqTau, // horizon time for the predi
 	}
 	iStrataTheCause = grid_strata(iStrata,theCause);
 
+	// *** unique covariate profiles
+	iStrata_profile = findProfile_cpp(profile_key.rows(newdata_index[iStrata]));
+	iStrata_indexProfile = newdata_index[iStrata](arma::find(iStrata_profile == arma::linspace<arma::uvec>(0, iStrata_nNewObs-1, iStrata_nNewObs)));
+	if(exportIFmean && diag){ // weights of the duplicated profiles are summed
+	  for(int iFactor=0; iFactor<nFactor; iFactor++){
+		iStrata_factorProfile[iFactor].zeros(iStrata_nNewObs, factor[iFactor].n_cols);
+		for(int iNewObs=0; iNewObs<iStrata_nNewObs; iNewObs++){
+		  iStrata_factorProfile[iFactor].row(iStrata_profile(iNewObs)) += factor[iFactor].row(newdata_index[iStrata](iNewObs));
+		}
+	  }
+	}
+
 	if(debug>1){Rcpp::Rcout << " (tau=" << iStrata_tau << "-" << iStrata_tauMax << ") " << endl;}
 	
 	// *** compute IF/SE/IFmean at each time point
@@ -181,6 +211,7 @@ List calcSeMinimalCSC_cpp(const arma::vec& seqTau, // horizon time for the predi
 
 		if(isJump_time1(iJump,iStrataTheCause)){ // only update for jumps corresponding to the event of interest in the strata
 		  for(int iNewObs=0; iNewObs<iStrata_nNewObs; iNewObs++){
+			if(iStrata_profile(iNewObs) != (unsigned int) iNewObs){continue;} // duplicated profile
 			iNewObs2 = newdata_index[iStrata](iNewObs);
 			if(diag){
 			  if(jump_time[iJump]>seqTau[iNewObs2]){continue;}
@@ -217,9 +248,9 @@ List calcSeMinimalCSC_cpp(const arma::vec& seqTau, // horizon time for the predi
 			if(exportIFmean && diag){
 			  for(int iFactor=0; iFactor<nFactor; iFactor++){
 				if(factor[iFactor].n_cols==1){ // same weight at all times
-				  IFmean_cif[iFactor].col(iTauStore) += iStrata_IFint * factor[iFactor](iNewObs2,0);
+				  IFmean_cif[iFactor].col(iTauStore) += iStrata_IFint * iStrata_factorProfile[iFactor](iNewObs,0);
 				}else{
-				  IFmean_cif[iFactor].col(iTauStore) += iStrata_IFint * factor[iFactor](iNewObs2,iJump);
+				  IFmean_cif[iFactor].col(iTauStore) += iStrata_IFint * iStrata_factorProfile[iFactor](iNewObs,iJump);
 				}
 			  }
 			}
@@ -231,7 +262,7 @@ List calcSeMinimalCSC_cpp(const arma::vec& seqTau, // horizon time for the predi
 			iStrata_tau++;
 			if(iStrata_tau <= iStrata_tauMax){
 			  if(exportIF || exportSE){
-				IF_cif.slice(iStrata_tau).cols(newdata_index[iStrata]) = IF_cif.slice(iStrata_tau-1).cols(newdata_index[iStrata]);
+				IF_cif.slice(iStrata_tau).cols(iStrata_indexProfile) = IF_cif.slice(iStrata_tau-1).cols(iStrata_indexProfile);
 			  }
 			}
 		  }
@@ -314,6 +345,17 @@ List calcSeMinimalCSC_cpp(const arma::vec& seqTau, // horizon time for the predi
       if((iStrata_tau > iStrata_tauMax) || (iStrata_tau2 > iStrata_tauMax)){break;}
 
 	} // end iJump
+
+	// *** copy the influence function to the duplicated profiles
+	if((exportIF || exportSE) && (iStrata_indexProfile.size() < (unsigned int) iStrata_nNewObs)){
+	  for(int iNewObs=0; iNewObs<iStrata_nNewObs; iNewObs++){
+		if(iStrata_profile(iNewObs) == (unsigned int) iNewObs){continue;}
+		iNewObs2 = newdata_index[iStrata](iNewObs);
+		for(unsigned int iSlice=0; iSlice<IF_cif.n_slices; iSlice++){
+		  IF_cif.slice(iSlice).col(iNewObs2) = IF_cif.slice(iSlice).col(newdata_index[iStrata](iStrata_profile(iNewObs)));
+		}
+	  }
+	}
 	if(debug>1){Rcpp::Rcout << std::endl;}
   } // end iStrata
 
@@ -429,6 +471,28 @@ List calcSeCif2_cpp(const std::vector<arma::mat>& ls_IFbeta, const std::vector<a
     iNJumpTime = nJumpTime;
   }
   
+  // ** covariate profiles
+  // observations with the same strata, linear predictors and design matrices (and prediction time when diag)
+  // have the same influence function: it is only computed for the first observation of each profile
+  arma::uvec profile = arma::linspace<arma::uvec>(0, nNewObs-1, nNewObs);
+  arma::vec nProfile = arma::ones<arma::vec>(nNewObs);
+  if(startObs < nNewObs){
+    arma::mat profile_key = arma::join_rows(arma::join_rows(strata, eXb), Rcpp::as<arma::vec>(JumpMax));
+    for(int iCause=0; iCause<nCause; iCause ++){
+      if(nVar[iCause]>0){
+	profile_key = arma::join_rows(profile_key, ls_X[iCause]);
+      }
+    }
+    if(diag){
+      profile_key = arma::join_rows(arma::join_rows(profile_key, Rcpp::as<arma::vec>(tau)), tauIndex);
+    }
+    profile.subvec(startObs, nNewObs-1) = findProfile_cpp(profile_key.rows(startObs, nNewObs-1)) + startObs;
+    nProfile.zeros();
+    for(int iNewObs=0; iNewObs<nNewObs; iNewObs++){
+      nProfile(profile(iNewObs)) += 1.0;
+    }
+  }
+  
   // ** prepare the influence function
   arma::uvec iUvec_linspace(1);
   arma::uvec iUvec_strata(1);
@@ -438,6 +502,7 @@ List calcSeCif2_cpp(const std::vector<arma::mat>& ls_IFbeta, const std::vector<a
     R_CheckUserInterrupt();
 
     if(iTau>=nTau){continue;}
+    if(profile(iNewObs) != (unsigned int) iNewObs){continue;} // duplicated profile
     
     if(diag){
       iiTau = iNewObs;
@@ -550,9 +615,9 @@ List calcSeCif2_cpp(const std::vector<arma::mat>& ls_IFbeta, const std::vector<a
 	if(exportIFsum){
 	  // Rcout << "c";
 	  if(diag && cif(iNewObs,0)<1){
-	    outIFsum.col(0) += cumIF_tempo;
+	    outIFsum.col(0) += nProfile(iNewObs) * cumIF_tempo;
 	  }else if(cif(iNewObs,iiTau)<1){
-	    outIFsum.col(iiTau) += cumIF_tempo;
+	    outIFsum.col(iiTau) += nProfile(iNewObs) * cumIF_tempo;
 	  }
 	}
 	// Rcout << "increment: " << iiTau << " " << iNTau << endl;
@@ -595,6 +660,21 @@ List calcSeCif2_cpp(const std::vector<arma::mat>& ls_IFbeta, const std::vector<a
     // Rcout << "endend" << endl;	
   }
 
+  // ** copy the influence function to the duplicated profiles
+  if(exportSE || exportIF){
+    for(int iNewObs=startObs; iNewObs<nNewObs; iNewObs++){
+      if(profile(iNewObs) == (unsigned int) iNewObs){continue;}
+      if(exportSE){
+	outSE.row(iNewObs) = outSE.row(profile(iNewObs));
+      }
+      if(exportIF){
+	for(unsigned int iSlice=0; iSlice<outIF.n_slices; iSlice++){
+	  outIF.slice(iSlice).row(iNewObs) = outIF.slice(iSlice).row(profile(iNewObs));
+	}
+      }
+    }
+  }
+
   if(exportIFsum){
     outIFsum /= nNewObs;
   }
@@ -608,3 +688,41 @@ List calcSeCif2_cpp(const std::vector<arma::mat>& ls_IFbeta, const std::vector<a
 }
 
 
+// * findProfile_cpp: group observations sharing the same covariate profile
+// key: one row per observation, one column per characteristic of the profile
+// return, for each observation, the row index of the first observation with the same key
+arma::uvec findProfile_cpp(const arma::mat& key){
+  int n = key.n_rows;
+  int nKey = key.n_cols;
+  arma::uvec profile(n);
+  if(n==0){return(profile);}
+
+  // NA are sorted last and considered equal to each other
+  auto lessKey = [](double x, double y){
+    if(std::isnan(y)){return(!std::isnan(x));}
+    if(std::isnan(x)){return(false);}
+    return(x < y);
+  };
+  auto lessRow = [&](int i, int j){
+    for(int iKey=0; iKey<nKey; iKey++){
+      if(lessKey(key(i,iKey),key(j,iKey))){return(true);}
+      if(lessKey(key(j,iKey),key(i,iKey))){return(false);}
+    }
+    return(false);
+  };
+
+  // stable sort so that the first observation of each profile comes first
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), lessRow);
+
+  int iFirst = order[0];
+  profile(iFirst) = iFirst;
+  for(int iObs=1; iObs<n; iObs++){
+    if(lessRow(order[iObs-1],order[iObs])){
+      iFirst = order[iObs];
+    }
+    profile(order[iObs]) = iFirst;
+  }
+  return(profile);
+}
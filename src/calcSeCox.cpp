@@ -1,9 +1,14 @@
 // [[Rcpp::depends(RcppArmadillo)]]
 #include <RcppArmadillo.h>
+#include <cstring>
+#include <stdint.h>
 
 using namespace Rcpp;
 using namespace std;
 
+void storeIFCox(arma::cube& IF, arma::fcube& IFfloat, bool floatIF, int iTau, int iObs, const arma::colvec& value);
+SEXP wrapIFCox(const arma::cube& IF, const arma::fcube& IFfloat, bool floatIF);
+
 // * calcSeMinimalCox_cpp: compute IF/sumIF/se for the hazard / cumlative hazard / survival (method 1)
 // J: number of jump times
 // n: number of observations in the training set
@@ -11,6 +16,10 @@ using namespace std;
 // p: number of regressors
 // S: number of strata
 // T: number of prediction times
+// floatIF: should the influence functions (IF_hazard, IF_cumhazard, IF_survival) be stored in single precision?
+//          They are converted to a new double precision vector when returned to R, so the peak memory per array is
+//          1.5 times (instead of twice) its double precision size; the returned object is unchanged.
+//          The standard errors and average influence functions are still computed in double precision.
 // [[Rcpp::export]]
 List calcSeMinimalCox_cpp(const arma::vec& seqTau, // horizon time for the predictions (T)
 						  const arma::mat& newSurvival, // predicted survival for all observations at each horizon time (NxT)
@@ -35,7 +44,7 @@ List calcSeMinimalCox_cpp(const arma::vec& seqTau, // horizon time for the predi
 						  int nTau, int nNewObs, int nSample, int nStrata, int p, 
 						  bool diag, bool exportSE, bool exportIF, bool exportIFmean,
 						  bool exportHazard, bool exportCumhazard, bool exportSurvival,
-						  int debug){
+						  int debug, bool floatIF = false){
 
   // ** prepare
   if(debug>0){Rcpp::Rcout << "Prepare" << std::endl;}
@@ -57,13 +66,18 @@ List calcSeMinimalCox_cpp(const arma::vec& seqTau, // horizon time for the predi
   arma::vec iStrata_weXb,iStrata_weXbS;
   arma::mat iStrata_weXbX,iStrata_weXbXS;
   arma::vec iSurvival;
+  arma::colvec NAcol(nSample);
+  NAcol.fill(NA_REAL);
 
   // ** initialize
   if(debug>0){Rcpp::Rcout << "Initialize" << std::endl;}
   arma::cube IF_hazard;
+  arma::fcube IF_hazardF;
   std::vector< arma::mat > IFmean_hazard(nFactor);
   if(exportHazard){
-	if(exportIF){
+	if(exportIF && floatIF){
+	  IF_hazardF.zeros(nSample, nNewObs, nTau);
+	}else if(exportIF){
 	  IF_hazard.resize(nSample, nNewObs, nTau);
 	  IF_hazard.fill(0.0);
 	}
@@ -76,10 +90,13 @@ List calcSeMinimalCox_cpp(const arma::vec& seqTau, // horizon time for the predi
   }
   
   arma::cube IF_cumhazard;
+  arma::fcube IF_cumhazardF;
   arma::mat SE_cumhazard;
   std::vector< arma::mat > IFmean_cumhazard(nFactor);
   if(exportCumhazard){
-	if(exportIF){
+	if(exportIF && floatIF){
+	  IF_cumhazardF.zeros(nSample, nNewObs, nTau);
+	}else if(exportIF){
 	  IF_cumhazard.resize(nSample, nNewObs, nTau);
 	  IF_cumhazard.fill(0.0);
 	}
@@ -96,10 +113,13 @@ List calcSeMinimalCox_cpp(const arma::vec& seqTau, // horizon time for the predi
   }
 
   arma::cube IF_survival;
+  arma::fcube IF_survivalF;
   arma::mat SE_survival;
   std::vector< arma::mat > IFmean_survival(nFactor);
   if(exportSurvival){
-	if(exportIF){
+	if(exportIF && floatIF){
+	  IF_survivalF.zeros(nSample, nNewObs, nTau);
+	}else if(exportIF){
 	  IF_survival.resize(nSample, nNewObs, nTau);
 	  IF_survival.fill(0.0);
 	}
@@ -158,7 +178,7 @@ List calcSeMinimalCox_cpp(const arma::vec& seqTau, // horizon time for the predi
 		}
 		
 		if(exportHazard){
-		  if(exportIF){IF_hazard.slice(iTauStore).col(iNewObs2).fill(NA_REAL);}
+		  if(exportIF){storeIFCox(IF_hazard, IF_hazardF, floatIF, iTauStore, iNewObs2, NAcol);}
 		  if(exportIFmean){
 			for(int iFactor=0; iFactor<nFactor; iFactor++){
 			  IFmean_hazard[iFactor].col(iTauStore).fill(NA_REAL);
@@ -167,7 +187,7 @@ List calcSeMinimalCox_cpp(const arma::vec& seqTau, // horizon time for the predi
 		}
 
 		if(exportCumhazard){
-		  if(exportIF){IF_cumhazard.slice(iTauStore).col(iNewObs2).fill(NA_REAL);}
+		  if(exportIF){storeIFCox(IF_cumhazard, IF_cumhazardF, floatIF, iTauStore, iNewObs2, NAcol);}
 		  if(exportSE){SE_cumhazard(iNewObs2,iTauStore) = NA_REAL;}
 		  if(exportIFmean){
 			for(int iFactor=0; iFactor<nFactor; iFactor++){
@@ -177,7 +197,7 @@ List calcSeMinimalCox_cpp(const arma::vec& seqTau, // horizon time for the predi
 		}
 
 		if(exportSurvival){
-		  if(exportIF){IF_survival.slice(iTauStore).col(iNewObs2).fill(NA_REAL);}
+		  if(exportIF){storeIFCox(IF_survival, IF_survivalF, floatIF, iTauStore, iNewObs2, NAcol);}
 		  if(exportSE){SE_survival(iNewObs2,iTauStore) = NA_REAL;}
 		  if(exportIFmean){
 			for(int iFactor=0; iFactor<nFactor; iFactor++){
@@ -262,9 +282,9 @@ List calcSeMinimalCox_cpp(const arma::vec& seqTau, // horizon time for the predi
 		  
 		  // store
 		  if(exportIF){
-			if(exportHazard){IF_hazard.slice(iTauStore).col(iNewObs2)= iStrata_IFhazard;}
-			if(exportCumhazard){IF_cumhazard.slice(iTauStore).col(iNewObs2) = iStrata_IFcumhazard;}
-			if(exportSurvival){IF_survival.slice(iTauStore).col(iNewObs2) = iStrata_IFsurvival;}
+			if(exportHazard){storeIFCox(IF_hazard, IF_hazardF, floatIF, iTauStore, iNewObs2, iStrata_IFhazard);}
+			if(exportCumhazard){storeIFCox(IF_cumhazard, IF_cumhazardF, floatIF, iTauStore, iNewObs2, iStrata_IFcumhazard);}
+			if(exportSurvival){storeIFCox(IF_survival, IF_survivalF, floatIF, iTauStore, iNewObs2, iStrata_IFsurvival);}
 		  }
 		  
 		  if(exportSE){
@@ -347,12 +367,12 @@ List calcSeMinimalCox_cpp(const arma::vec& seqTau, // horizon time for the predi
 
   // ** Export
   if(debug>0){Rcpp::Rcout << "Export" << std::endl;}
-  return(List::create(Named("IF_hazard") = IF_hazard,
+  return(List::create(Named("IF_hazard") = wrapIFCox(IF_hazard, IF_hazardF, floatIF),
 					  Named("IFmean_hazard") = IFmean_hazard,
-					  Named("IF_cumhazard") = IF_cumhazard,
+					  Named("IF_cumhazard") = wrapIFCox(IF_cumhazard, IF_cumhazardF, floatIF),
 					  Named("SE_cumhazard") = SE_cumhazard,
 					  Named("IFmean_cumhazard") = IFmean_cumhazard,
-					  Named("IF_survival") = IF_survival,
+					  Named("IF_survival") = wrapIFCox(IF_survival, IF_survivalF, floatIF),
 					  Named("SE_survival") = SE_survival,
 					  Named("IFmean_survival") = IFmean_survival));
 }
@@ -511,3 +531,47 @@ std::vector< std::vector<arma::mat> > calcAIFsurv_cpp(const std::vector<arma::ma
   return(out);
   
 }
+
+// * storeIFCox
+// store the influence function of one prediction in the double or single precision array
+// (in single precision, NA are stored as a NaN with a dedicated payload, as R does for NA_real_,
+//  so that they can be distinguished from the NaN resulting from the calculations)
+static const uint32_t floatNA_bits = 0x7FC007A2; // quiet NaN with payload 1954
+
+static inline float floatNA(){
+  float out;
+  std::memcpy(&out, &floatNA_bits, sizeof(float));
+  return(out);
+}
+
+static inline bool isFloatNA(float x){
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(float));
+  return(bits == floatNA_bits);
+}
+
+void storeIFCox(arma::cube& IF, arma::fcube& IFfloat, bool floatIF, int iTau, int iObs, const arma::colvec& value){
+  if(floatIF){
+	float* colF = IFfloat.slice_colptr(iTau, iObs);
+	for(arma::uword i=0; i<value.n_elem; i++){
+	  colF[i] = R_IsNA(value[i]) ? floatNA() : (float) value[i];
+	}
+  }else{
+	IF.slice(iTau).col(iObs) = value;
+  }
+}
+
+// * wrapIFCox
+// convert the array of influence functions to R
+// (only the values stored as NA are restored as NA, other NaN are kept)
+SEXP wrapIFCox(const arma::cube& IF, const arma::fcube& IFfloat, bool floatIF){
+  if(floatIF == false){
+	return(wrap(IF));
+  }
+  NumericVector out(IFfloat.n_elem);
+  for(arma::uword i=0; i<IFfloat.n_elem; i++){
+	out[i] = isFloatNA(IFfloat[i]) ? NA_REAL : (double) IFfloat[i];
+  }
+  out.attr("dim") = IntegerVector::create((int) IFfloat.n_rows, (int) IFfloat.n_cols, (int) IFfloat.n_slices);
+  return(out);
+}
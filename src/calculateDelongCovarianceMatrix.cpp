@@ -1,84 +1,193 @@
 // [[Rcpp::depends(RcppArmadillo)]]
 #include <RcppArmadillo.h>
+#include <algorithm>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 using namespace Rcpp;
 using namespace arma;
 // C++ functions for calculating the asymptotic covariance matrix for the delongtest function.
 
-// calculates midrank
-vec calculateMidrank(vec& z){
-  int m = z.size();
-  vec wtemp = sort(z);
-  uvec index = sort_index(z);
-  vec w(m+1);
-  for (int i = 0; i <m;i++ ){
-    w[i]=wtemp[i];
-  }
-  w[m]=wtemp[m-1]+1;
-  vec t(m);
-  int i = 0;
-  int a, b, j;
-  while (i < m){
-    a = i;
-    j = a;
-      while (w[j]==w[a]){
-        j+=1;
-      }
-      b = j - 1;
-    for (int k = a; k <= b; k++){
-      t[k] = (double)(a+b)/2;
-    }
-    i = b+1;
-  }
-  int k;
-  vec tk(m);
-  for (i = 0; i < m; i++){
-    k = index[i];
-    tk[k] = t[i]+1;
-  }
-  return tk;
-}
+void delongPlacements(const double* x, int m, const double* y, int n,
+                      const double* wx, const double* wy,
+                      std::vector<int>& index, double* v10, double* v01);
 
 // Fast implementation of the calculation of the covariance matrix.
 // Number of rows is the number of observations, for X and Y respectively
 // Number of columns is the number of experiments
-// we note here that pointers and references should be used in order
-// to make efficient use of memory
+// The experiments are distributed over ncores threads (when compiled with OpenMP).
 // [[Rcpp::export]]
-NumericMatrix calculateDelongCovarianceFast(NumericMatrix& Xs, NumericMatrix& Ys){
+NumericMatrix calculateDelongCovarianceFast(NumericMatrix& Xs, NumericMatrix& Ys, int ncores = 1){
   int m = Xs.nrow();
   int n = Ys.nrow();
   if (Xs.ncol()!=Ys.ncol()){
     stop("Incompatible matrix dimensions.");
   }
   int k = Xs.ncol();
-  mat V10(k,m);
-  mat V01(k,n);
-  //can be used for more efficient computation of cov. matrix, but that code isn't working
-  for (int r = 0; r < k; r++){
-    // Make them into armadillo vectors; might be an inefficient and superfluous operation
-    // strangely enough we cannot write Xr = as<vec>(Xs(_,r))
-    // for now it seems to work well enough
-    NumericVector Xx = Xs(_,r);
-    NumericVector Yy = Ys(_,r);
-    vec Xr = as<vec>(Xx);
-    vec Yr = as<vec>(Yy);
+  // one column per experiment
+  mat V10(m,k);
+  mat V01(n,k);
+  const double* X = Xs.begin();
+  const double* Y = Ys.begin();
+#ifdef _OPENMP
+#pragma omp parallel num_threads(ncores > 0 ? ncores : 1)
+#endif
+  {
+    std::vector<int> index(m+n);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (int r = 0; r < k; r++){
+      delongPlacements(X + (size_t) m * r, m, Y + (size_t) n * r, n, NULL, NULL,
+                       index, V10.colptr(r), V01.colptr(r));
+    }
+  }
+  mat S(k,k);
+  mat s10 = arma::cov(V10);
+  mat s01 = arma::cov(V01);
+  S = s01/((double) n)+s10/((double) m);
+  return wrap(S);
+}
 
-    // concatenate
-    vec Zr = join_cols(Xr,Yr);
-    // calculate midranks
-    vec TZr = calculateMidrank(Zr);
-    vec TXr = calculateMidrank(Xr);
-    vec TYr = calculateMidrank(Yr);
+// Weighted and clustered version of calculateDelongCovarianceFast.
+// weightsX and weightsY are the (e.g. IPCW or sampling) weights of the cases and the controls.
+// The weighted AUC is sum_ij wx_i wy_j psi(x_i,y_j)/(sum_i wx_i sum_j wy_j) and its
+// influence function is wx_i (V10_i-AUC)/sum(wx) for case i and wy_j (V01_j-AUC)/sum(wy) for control j,
+// where V10 and V01 are the weighted placement values.
+// Without clusters (clusterX and clusterY of length 0) the covariance is m/(m-1) times the
+// crossproduct of the case terms plus n/(n-1) times the crossproduct of the control terms,
+// which gives calculateDelongCovarianceFast for unit weights.
+// With clusters (positive integers, not necessarily contiguous, shared between cases and controls)
+// the terms are first summed within each of the G distinct clusters and the covariance is
+// G/(G-1) times the crossproduct of the cluster sums.
+// Not called by Score: AUC.binary estimates the unweighted AUC of independent subjects and uses
+// calculateDelongCovarianceFast. This entry point is for callers with sampling weights or clustered data.
+// [[Rcpp::export]]
+List calculateDelongCovarianceWeighted(NumericMatrix& Xs, NumericMatrix& Ys,
+                                       NumericVector weightsX, NumericVector weightsY,
+                                       IntegerVector clusterX, IntegerVector clusterY,
+                                       int ncores = 1){
+  int m = Xs.nrow();
+  int n = Ys.nrow();
+  if (Xs.ncol()!=Ys.ncol()){
+    stop("Incompatible matrix dimensions.");
+  }
+  if (weightsX.size()!=m || weightsY.size()!=n){
+    stop("Incompatible length of the weights.");
+  }
+  bool cluster = clusterX.size()>0 || clusterY.size()>0;
+  if (cluster && (clusterX.size()!=m || clusterY.size()!=n)){
+    stop("Incompatible length of the cluster variables.");
+  }
+  int k = Xs.ncol();
+  double WX = sum(weightsX);
+  double WY = sum(weightsY);
+  mat V10(m,k);
+  mat V01(n,k);
+  const double* X = Xs.begin();
+  const double* Y = Ys.begin();
+  const double* wx = weightsX.begin();
+  const double* wy = weightsY.begin();
+#ifdef _OPENMP
+#pragma omp parallel num_threads(ncores > 0 ? ncores : 1)
+#endif
+  {
+    std::vector<int> index(m+n);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (int r = 0; r < k; r++){
+      delongPlacements(X + (size_t) m * r, m, Y + (size_t) n * r, n, wx, wy,
+                       index, V10.colptr(r), V01.colptr(r));
+    }
+  }
+  // weighted AUC: weighted mean of the placement values of the cases
+  vec wX(weightsX.begin(),m);
+  vec wY(weightsY.begin(),n);
+  rowvec auc = (wX.t() * V10)/WX;
+  // ** influence function
+  mat IF10 = V10.each_row() - auc;
+  IF10.each_col() %= wX/WX;
+  mat IF01 = V01.each_row() - auc;
+  IF01.each_col() %= wY/WY;
+  mat S(k,k);
+  if (!cluster){
+    S = IF10.t() * IF10 * (m/(m-1.0)) + IF01.t() * IF01 * (n/(n-1.0));
+  }else{
+    // ** map the cluster ids to 0,...,G-1
+    std::vector<int> id(clusterX.begin(),clusterX.end());
+    id.insert(id.end(),clusterY.begin(),clusterY.end());
+    for (size_t i = 0; i < id.size(); i++){
+      if (id[i] == NA_INTEGER || id[i] <= 0){
+        stop("The cluster variables should contain positive integers.");
+      }
+    }
+    std::sort(id.begin(),id.end());
+    id.erase(std::unique(id.begin(),id.end()),id.end());
+    int G = id.size();
+    if (G < 2){
+      stop("At least two clusters are needed to estimate the covariance.");
+    }
+    mat U(G,k,fill::zeros);
     for (int i = 0; i < m; i++){
-      V10(r,i)=(TZr[i]-TXr[i])/((double) n);
+      U.row(std::lower_bound(id.begin(),id.end(),clusterX[i])-id.begin()) += IF10.row(i);
     }
     for (int j = 0; j < n; j++){
-      V01(r,j)=1.0-(TZr[j+m]-TYr[j])/((double) m);
+      U.row(std::lower_bound(id.begin(),id.end(),clusterY[j])-id.begin()) += IF01.row(j);
     }
+    S = U.t() * U * (G/(G-1.0));
+  }
+  return(List::create(Named("AUC") = conv_to<std::vector<double> >::from(auc),
+                      Named("vcov") = wrap(S)));
+}
+
+// Structural components (placement values) of one experiment:
+// v10[i] is the proportion of y below x[i] (ties count 1/2) and
+// v01[j] the proportion of x above y[j] (ties count 1/2),
+// weighted by wx and wy unless these are NULL.
+// These are (TZ-TX)/n and 1-(TZ-TY)/m where TZ, TX and TY are the midranks
+// of the pooled sample, of x and of y. All three are obtained from a single
+// sort of the pooled sample: within a block of ties the midranks only depend
+// on the number (total weight) of x and y before and inside the block.
+void delongPlacements(const double* x, int m, const double* y, int n,
+                      const double* wx, const double* wy,
+                      std::vector<int>& index, double* v10, double* v01){
+  int N = m+n;
+  double WX = 0, WY = 0;
+  for (int i = 0; i < m; i++) WX += wx == NULL ? 1.0 : wx[i];
+  for (int j = 0; j < n; j++) WY += wy == NULL ? 1.0 : wy[j];
+  for (int i = 0; i < N; i++) index[i] = i;
+  // index < m refers to x, otherwise to y
+  std::sort(index.begin(),index.begin()+N,[x,y,m](int a, int b){
+    double za = a < m ? x[a] : y[a-m];
+    double zb = b < m ? x[b] : y[b-m];
+    return za < zb;
+  });
+  double nxBefore = 0, nyBefore = 0;
+  int a = 0;
+  while (a < N){
+    double za = index[a] < m ? x[index[a]] : y[index[a]-m];
+    // ** find the block of ties
+    int b = a;
+    double nxTie = 0, nyTie = 0;
+    while (b < N){
+      double zb = index[b] < m ? x[index[b]] : y[index[b]-m];
+      if (zb != za) break;
+      if (index[b] < m) nxTie += wx == NULL ? 1.0 : wx[index[b]];
+      else nyTie += wy == NULL ? 1.0 : wy[index[b]-m];
+      b++;
+    }
+    // ** placement values
+    for (int l = a; l < b; l++){
+      if (index[l] < m){
+        v10[index[l]] = (nyBefore + 0.5 * nyTie)/WY;
+      }else{
+        v01[index[l]-m] = 1.0 - (nxBefore + 0.5 * nxTie)/WX;
+      }
+    }
+    nxBefore += nxTie;
+    nyBefore += nyTie;
+    a = b;
   }
-  mat S(k,k);
-  mat s10 = arma::cov(V10.t());
-  mat s01 = arma::cov(V01.t());
-  S = s01/((double) n)+s10/((double) m);
-  return wrap(S);
 }
@@ -1,5 +1,12 @@
 // [[Rcpp::depends(RcppArmadillo)]]
 #include <RcppArmadillo.h>
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace Rcpp;
 using namespace std;
@@ -7,6 +14,13 @@ using namespace std;
 void sampleMaxProcess_cpp(int nSample, int nContrast, int nSim,
 						  const arma::mat& value, arma::cube& iid, arma::mat& Msample, int alternative, int type, bool global);
 
+uint64_t seedCounterRNG();
+void counterRnorm(arma::colvec& G, uint64_t seed, uint64_t iSim);
+int sizeBlockProcess(int blockSize, int nSim, int nSample, int nTime, int nContrast);
+void pushHeapProcess(std::vector<double>& heap, double x, int nKeep, bool keepLargest);
+void simulateBlockProcess(const arma::cube& iid, int iSim0, int nBlock, bool counterRNG, uint64_t seed,
+						  arma::mat& G, arma::cube& iidG);
+
 // * quantileProcess_cpp
 // Compute equicoordinate-quantile using simulations
 // nSample: number of observations used to fit the model
@@ -15,57 +29,119 @@ void sampleMaxProcess_cpp(int nSample, int nContrast, int nSim,
 // iid: influence function (nTimes, nSample, nContrast)
 // alternative: 1 one sided below, 2 one sided above, 3 two sided
 // global: [logical] should the max be taking over contrasts?
+// counterRNG: [logical] should the multipliers be generated by a counter-based generator seeded from R?
+//             The multipliers of a simulation then only depend on the seed and on the simulation index
+//             so the simulations can be run in parallel and give the same result whatever the number of threads.
+// ncores: number of threads used when counterRNG is TRUE (requires OpenMP)
+// blockSize: number of simulations performed at once, i.e. with one matrix product (nTime,nSample)x(nSample,blockSize) per contrast.
+//            0 means automatic (at most 256 simulations and about 8Mb per block matrix).
+//            Does not affect the multipliers, so the results do not depend on blockSize (up to floating point rounding).
+// streaming: [logical] should the simulated statistics be discarded as soon as they cannot be the quantile?
+//            Only the nSim*(1-confLevel) largest (or smallest) statistics are kept in a heap, instead of all nSim statistics.
+//            Gives exactly the same quantile.
 // [[Rcpp::export]]
 NumericVector quantileProcess_cpp(int nSample, int nContrast, int nSim,
 								  arma::cube& iid,
 								  int alternative,
 								  bool global,
-								  double confLevel){
+								  double confLevel,
+								  bool counterRNG = false,
+								  int ncores = 1,
+								  int blockSize = 0,
+								  bool streaming = false){
 
   void GetRNGstate(),PutRNGstate(); 
   GetRNGstate();
+  uint64_t seed = counterRNG ? seedCounterRNG() : 0;
 
-  // ** perform simulation
-  arma::colvec G; // individual weights
-  arma::mat iidG; // temporary curve
-  arma::mat Mstore(nSim, nContrast); // store simulation results
+  // ** prepare
+  // the quantile is the value at position indexQuantile among the sorted simulated statistics
+  int indexQuantile;
+  if(alternative==1){
+	indexQuantile = round(nSim * (1-confLevel));
+  }else{
+	indexQuantile = round(nSim * confLevel);
+  }
+  // streaming: only keep the nKeep smallest (or largest) statistics, the quantile being the largest (or smallest) of them
+  bool keepLargest = (nSim - indexQuantile) < (indexQuantile + 1);
+  int nKeep = keepLargest ? (nSim - indexQuantile) : (indexQuantile + 1);
+  arma::mat Mstore(streaming ? 0 : nSim, nContrast); // store simulation results
+  std::vector< std::vector<double> > Mkeep(streaming ? nContrast : 0); // store the selected simulation results (all threads)
 
-  for(int iSim=0; iSim<nSim; iSim++){ 
-	G = rnorm(nSample, 0, 1);
-	iidG = iid.each_slice() * G;
+  int nBlock = sizeBlockProcess(blockSize, nSim, nSample, iid.n_rows, nContrast);
+  int nBlocks = (nSim + nBlock - 1) / nBlock;
+
+  // ** perform simulation
+#ifdef _OPENMP
+#pragma omp parallel if(counterRNG && ncores > 1) num_threads(ncores > 0 ? ncores : 1)
+#endif
+  {
+  arma::mat G; // individual weights (nSample, nBlock)
+  arma::cube iidG; // temporary curves (nTime, nBlock, nContrast)
+  arma::mat Mblock(nBlock, nContrast); // simulation results of the block
+  std::vector< std::vector<double> > heap(streaming ? nContrast : 0); // selected simulation results (thread)
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+  for(int iBlock=0; iBlock<nBlocks; iBlock++){ 
+	int iSim0 = iBlock * nBlock;
+	int nSimBlock = std::min(nBlock, nSim - iSim0);
+	simulateBlockProcess(iid, iSim0, nSimBlock, counterRNG, seed, G, iidG);
  
 	for (int iC = 0; iC < nContrast; iC++) { // take the more extreme statistic (over time) for each contrast 
 	  if(alternative==1){
-		Mstore(iSim,iC) = iidG.col(iC).min();
+		Mblock(arma::span(0,nSimBlock-1),iC) = arma::min(iidG.slice(iC),0).t();
 	  }else if(alternative==2){
-		Mstore(iSim,iC) = iidG.col(iC).max();
+		Mblock(arma::span(0,nSimBlock-1),iC) = arma::max(iidG.slice(iC),0).t();
 	  }else if(alternative==3){
-		Mstore(iSim,iC) = abs(iidG.col(iC)).max();
+		Mblock(arma::span(0,nSimBlock-1),iC) = arma::max(abs(iidG.slice(iC)),0).t();
 	  }
 	}
 	  
 	if(global){ // take the more extreme statistic (over contrasts)
-	  if(alternative==1){ 
-		Mstore.row(iSim).fill(Mstore.row(iSim).min()); 
-	  }else{
-		Mstore.row(iSim).fill(Mstore.row(iSim).max()); 
+	  for(int iSim=0; iSim<nSimBlock; iSim++){ 
+		if(alternative==1){ 
+		  Mblock.row(iSim).fill(Mblock.row(iSim).min()); 
+		}else{
+		  Mblock.row(iSim).fill(Mblock.row(iSim).max()); 
+		}
 	  }
 	}
-  }
 
-  // ** compute quantile
-  int indexQuantile;
-  if(alternative==1){
-	indexQuantile = round(nSim * (1-confLevel));
-  }else{
-	indexQuantile = round(nSim * confLevel);
+	if(streaming){ // update the heaps
+	  for (int iC = 0; iC < nContrast; iC++) {
+		for(int iSim=0; iSim<nSimBlock; iSim++){
+		  pushHeapProcess(heap[iC], Mblock(iSim,iC), nKeep, keepLargest);
+		}
+	  }
+	}else{
+	  Mstore.rows(iSim0, iSim0+nSimBlock-1) = Mblock.rows(0, nSimBlock-1);
+	}
+  }
+  if(streaming){ // pool the threads
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+	for (int iC = 0; iC < nContrast; iC++) {
+	  Mkeep[iC].insert(Mkeep[iC].end(), heap[iC].begin(), heap[iC].end());
+	}
   }
-  arma::colvec tempo;
+  }
+
+  // ** compute quantile (selection instead of sorting)
   NumericVector Vquantile(nContrast);
-    
   for (int iCol = 0; iCol < nContrast; iCol++){
-    tempo = sort(Mstore.col(iCol));
-	Vquantile[iCol] = tempo[indexQuantile];
+	if(streaming){
+	  // the pooled heaps contain the nKeep smallest (or largest) statistics
+	  std::vector<double>& tempo = Mkeep[iCol];
+	  int index = keepLargest ? (int) tempo.size() - nKeep : nKeep - 1;
+	  std::nth_element(tempo.begin(), tempo.begin() + index, tempo.end());
+	  Vquantile[iCol] = tempo[index];
+	}else{
+	  double* tempo = Mstore.colptr(iCol);
+	  std::nth_element(tempo, tempo + indexQuantile, tempo + nSim);
+	  Vquantile[iCol] = tempo[indexQuantile];
+	}
   }
   
   PutRNGstate();
@@ -82,31 +158,59 @@ NumericVector quantileProcess_cpp(int nSample, int nContrast, int nSim,
 // iid: influence function (nTimes, nSample, nContrast)
 // alternative: 1 one sided below, 2 one sided above, 3 two sided
 // global: [logical] should the max be taking over contrasts?
+// counterRNG: [logical] should the multipliers be generated by a counter-based generator seeded from R?
+//             The multipliers of a simulation then only depend on the seed and on the simulation index
+//             so the simulations can be run in parallel and give the same result whatever the number of threads.
+// ncores: number of threads used when counterRNG is TRUE (requires OpenMP)
+// blockSize: number of simulations performed at once, i.e. with one matrix product (nTime,nSample)x(nSample,blockSize) per contrast.
+//            0 means automatic (at most 256 simulations and about 8Mb per block matrix).
+//            Does not affect the multipliers, so the results do not depend on blockSize (up to floating point rounding).
 // [[Rcpp::export]]
 arma::mat pProcess_cpp(int nSample, int nContrast, int nTime, int nSim,
 						   arma::mat value,
 						   arma::cube& iid,
 						   int alternative,
-						   bool global){
+						   bool global,
+						   bool counterRNG = false,
+						   int ncores = 1,
+						   int blockSize = 0){
 
   void GetRNGstate(),PutRNGstate(); 
   GetRNGstate();
+  uint64_t seed = counterRNG ? seedCounterRNG() : 0;
 
   // ** prepare
   arma::mat pmat(nContrast,nTime);
   pmat.fill(0.0);
 
-  arma::colvec G(nSample); // individual weights
-  arma::mat iidG(nTime,nContrast); // temporary curve
   if(alternative==3){
 	value = abs(value);
   }
-  double iEx=NA_REAL;
   
   // ** simulation
-  for(int iSim=0; iSim<nSim; iSim++){ 
-	G = rnorm(nSample, 0, 1);
-	iidG = iid.each_slice() * G;
+  int nBlock = sizeBlockProcess(blockSize, nSim, nSample, nTime, nContrast);
+  int nBlocks = (nSim + nBlock - 1) / nBlock;
+#ifdef _OPENMP
+#pragma omp parallel if(counterRNG && ncores > 1) num_threads(ncores > 0 ? ncores : 1)
+#endif
+  {
+  arma::mat G; // individual weights (nSample, nBlock)
+  arma::cube iidGblock; // temporary curves (nTime, nBlock, nContrast)
+  arma::mat iidG(nTime,nContrast); // temporary curve
+  arma::mat pmatThread(nContrast,nTime,arma::fill::zeros); // counts of the thread (integers, so the sum does not depend on the number of threads)
+  double iEx=NA_REAL;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+  for(int iBlock=0; iBlock<nBlocks; iBlock++){ 
+	int iSim0 = iBlock * nBlock;
+	int nSimBlock = std::min(nBlock, nSim - iSim0);
+	simulateBlockProcess(iid, iSim0, nSimBlock, counterRNG, seed, G, iidGblock);
+
+  for(int iSimBlock=0; iSimBlock<nSimBlock; iSimBlock++){ 
+	for (int iC = 0; iC < nContrast; iC++) {
+	  iidG.col(iC) = iidGblock.slice(iC).col(iSimBlock);
+	}
 
 	if(global==true){
 	  if(alternative==1){
@@ -130,23 +234,151 @@ arma::mat pProcess_cpp(int nSample, int nContrast, int nTime, int nSim,
 	  for (int iT = 0; iT < nTime; iT++) { // for each time
 		if(alternative == 1){
 		  if(iEx <= value(iC,iT)){
-			pmat(iC,iT)++ ;
+			pmatThread(iC,iT)++ ;
 		  }
 		}else{
 		  if(iEx >= value(iC,iT)){
-			pmat(iC,iT)++ ;
+			pmatThread(iC,iT)++ ;
 		  }
 		}
 	  }
 	}
 	
   }
+  }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+  pmat += pmatThread;
+  }
 
   PutRNGstate();
   
   return(pmat / nSim);
 }
 
+// * pProcessAdaptive_cpp
+// Same as pProcess_cpp but the simulation of a p-value stops as soon as it is clear
+// on which side of the significance levels it lies.
+// After each block of simulations a Wilson confidence interval (level confStop) is computed for each p-value
+// and the p-value is frozen when none of the significance levels alpha belongs to the interval.
+// The simulation stops when all p-values are frozen or after nSim simulations.
+// alpha: significance levels
+// confStop: confidence level of the stopping rule (should be high since the rule is applied after each block)
+// Returns the p-values and the number of simulations used for each of them.
+// [[Rcpp::export]]
+List pProcessAdaptive_cpp(int nSample, int nContrast, int nTime, int nSim,
+						  arma::mat value,
+						  arma::cube& iid,
+						  int alternative,
+						  bool global,
+						  NumericVector alpha,
+						  double confStop = 0.999,
+						  bool counterRNG = false,
+						  int blockSize = 0){
+
+  if(alpha.size() == 0){
+	stop("Argument \'alpha\' should contain at least one significance level.");
+  }
+
+  void GetRNGstate(),PutRNGstate(); 
+  GetRNGstate();
+  uint64_t seed = counterRNG ? seedCounterRNG() : 0;
+
+  // ** prepare
+  arma::mat pmat(nContrast,nTime,arma::fill::zeros); // number of simulations more extreme than the observed value
+  arma::mat nmat(nContrast,nTime,arma::fill::zeros); // number of simulations
+  arma::umat active(nContrast,nTime); // p-values still being simulated
+  active.fill(1);
+  int nActive = nContrast * nTime;
+  double z = R::qnorm(1 - (1 - confStop) / 2, 0.0, 1.0, true, false);
+  double z2 = z * z;
+
+  if(alternative==3){
+	value = abs(value);
+  }
+  arma::mat G; // individual weights (nSample, nBlock)
+  arma::cube iidGblock; // temporary curves (nTime, nBlock, nContrast)
+  arma::mat iidG(nTime,nContrast); // temporary curve
+  double iEx=NA_REAL;
+  int nBlock = sizeBlockProcess(blockSize, nSim, nSample, nTime, nContrast);
+
+  // ** simulation
+  for(int iSim0=0; iSim0<nSim && nActive>0; iSim0+=nBlock){ 
+	int nSimBlock = std::min(nBlock, nSim - iSim0);
+	simulateBlockProcess(iid, iSim0, nSimBlock, counterRNG, seed, G, iidGblock);
+
+	for(int iSimBlock=0; iSimBlock<nSimBlock; iSimBlock++){ 
+	  for (int iC = 0; iC < nContrast; iC++) {
+		iidG.col(iC) = iidGblock.slice(iC).col(iSimBlock);
+	  }
+	  if(global==true){
+		if(alternative==1){
+		  iEx = iidG.min();
+		}else if(alternative==2){
+		  iEx = iidG.max();
+		}else if(alternative==3){
+		  iEx = abs(iidG).max();
+		}
+	  }
+	  for (int iC = 0; iC < nContrast; iC++) { // take the more extreme statistic (over time) for each contrast
+		if(global==false){
+		  if(alternative==1){
+			iEx = iidG.col(iC).min();
+		  }else if(alternative==2){
+			iEx = iidG.col(iC).max();
+		  }else if(alternative==3){
+			iEx = abs(iidG.col(iC)).max();
+		  }
+		}
+		for (int iT = 0; iT < nTime; iT++) { // for each time
+		  if(active(iC,iT) == 0){
+			continue;
+		  }
+		  nmat(iC,iT)++ ;
+		  if(alternative == 1){
+			if(iEx <= value(iC,iT)){
+			  pmat(iC,iT)++ ;
+			}
+		  }else{
+			if(iEx >= value(iC,iT)){
+			  pmat(iC,iT)++ ;
+			}
+		  }
+		}
+	  }
+	}
+
+	// ** stopping rule
+	for (int iC = 0; iC < nContrast; iC++) {
+	  for (int iT = 0; iT < nTime; iT++) {
+		if(active(iC,iT) == 0){
+		  continue;
+		}
+		double n = nmat(iC,iT);
+		double phat = pmat(iC,iT) / n;
+		double center = (phat + z2 / (2 * n)) / (1 + z2 / n);
+		double halfWidth = z / (1 + z2 / n) * sqrt(phat * (1 - phat) / n + z2 / (4 * n * n));
+		bool excluded = true;
+		for (int iA = 0; iA < alpha.size(); iA++) {
+		  if(alpha[iA] >= center - halfWidth && alpha[iA] <= center + halfWidth){
+			excluded = false;
+		  }
+		}
+		if(excluded){
+		  active(iC,iT) = 0;
+		  nActive--;
+		}
+	  }
+	}
+  }
+
+  PutRNGstate();
+  
+  return(List::create(Named("p.value") = pmat / nmat,
+					  Named("n.sim") = nmat));
+}
+
 // * sampleMaxProcess_cpp
 // nSample: number of observations used to fit the model
 // nContrast: number of contrasts for which a different max is computed
@@ -156,16 +388,27 @@ arma::mat pProcess_cpp(int nSample, int nContrast, int nTime, int nSim,
 // alternative: 1 one sided below, 2 one sided above, 3 two sided
 // type: 1 max test (Kolmogorov-Smirnov type supremum), 2 L2 test (Camer-von-Mises)
 // global: [logical] should the max be taking over contrasts?
+// counterRNG: [logical] should the multipliers be generated by a counter-based generator seeded from R?
+//             The multipliers of a simulation then only depend on the seed and on the simulation index
+//             so the simulations can be run in parallel and give the same result whatever the number of threads.
+// ncores: number of threads used when counterRNG is TRUE (requires OpenMP)
+// blockSize: number of simulations performed at once, i.e. with one matrix product (nTime,nSample)x(nSample,blockSize) per contrast.
+//            0 means automatic (at most 256 simulations and about 8Mb per block matrix).
+//            Does not affect the multipliers, so the results do not depend on blockSize (up to floating point rounding).
 // [[Rcpp::export]]
 arma::mat sampleMaxProcess_cpp(int nSample, int nContrast, int nSim,
 							   const arma::mat& value,
 							   arma::cube& iid,
 							   int alternative,
 							   int type,
-							   bool global){
+							   bool global,
+							   bool counterRNG = false,
+							   int ncores = 1,
+							   int blockSize = 0){
 
   void GetRNGstate(),PutRNGstate(); 
   GetRNGstate();
+  uint64_t seed = counterRNG ? seedCounterRNG() : 0;
 
   // ** check arguments
   bool rmValue = abs(value.max())>1e-12;
@@ -176,8 +419,6 @@ arma::mat sampleMaxProcess_cpp(int nSample, int nContrast, int nSim,
   }
 
   // ** prepare
-  arma::colvec G;
-  arma::mat iidG;
   arma::mat maxTime_sample(nSim,nContrast);
   arma::rowvec Svalue;
   if(type==1){
@@ -201,9 +442,27 @@ arma::mat sampleMaxProcess_cpp(int nSample, int nContrast, int nSim,
   }
 
   // ** run
-  for(int iSim=0; iSim<nSim; iSim++){ 
-	G = rnorm(nSample, 0, 1);
-	iidG = iid.each_slice() * G;
+  int nBlock = sizeBlockProcess(blockSize, nSim, nSample, iid.n_rows, nContrast);
+  int nBlocks = (nSim + nBlock - 1) / nBlock;
+#ifdef _OPENMP
+#pragma omp parallel if(counterRNG && ncores > 1) num_threads(ncores > 0 ? ncores : 1)
+#endif
+  {
+  arma::mat G;
+  arma::cube iidGblock;
+  arma::mat iidG(iid.n_rows,nContrast);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+  for(int iBlock=0; iBlock<nBlocks; iBlock++){ 
+	int iSim0 = iBlock * nBlock;
+	int nSimBlock = std::min(nBlock, nSim - iSim0);
+	simulateBlockProcess(iid, iSim0, nSimBlock, counterRNG, seed, G, iidGblock);
+
+  for(int iSim=iSim0; iSim<iSim0+nSimBlock; iSim++){ 
+	for (int iC = 0; iC < nContrast; iC++) {
+	  iidG.col(iC) = iidGblock.slice(iC).col(iSim-iSim0);
+	}
  
 	for (int iCol = 0; iCol < nContrast; ++iCol) { // each contrast take the largest statistic
 	  if(type==1){
@@ -231,8 +490,323 @@ arma::mat sampleMaxProcess_cpp(int nSample, int nContrast, int nSim,
 		maxTime_sample.row(iSim).fill(maxTime_sample.row(iSim).max()); // take the largest statistic over all contrasts
 	  }
   }
+  }
+  }
   
   PutRNGstate();
   
   return(maxTime_sample);
 }
+
+// * simulateProcess_cpp
+// Compute in a single pass, i.e. from the same simulated processes,
+// the equicoordinate-quantile (as quantileProcess_cpp), the adjusted p-values (as pProcess_cpp)
+// and the p-values of the KS, CvM and sum tests (as colMeans(sampleMaxProcess_cpp(...)>0) for type 1, 2, and 3).
+// nSample: number of observations used to fit the model
+// nContrast: number of contrasts for which a different max is computed
+// nSim: number of simulations
+// value: observed value (nTimes, nContrast)
+// iid: influence function (nTimes, nSample, nContrast)
+// alternative: 1 one sided below, 2 one sided above, 3 two sided
+// global: [logical] should the max be taking over contrasts?
+// confLevel: confidence level of the quantile (NA: the quantile is not computed and set to NA)
+// counterRNG, ncores, blockSize: see quantileProcess_cpp
+// [[Rcpp::export]]
+List simulateProcess_cpp(int nSample, int nContrast, int nSim,
+						 const arma::mat& value,
+						 arma::cube& iid,
+						 int alternative,
+						 bool global,
+						 double confLevel = NA_REAL,
+						 bool counterRNG = false,
+						 int ncores = 1,
+						 int blockSize = 0){
+
+  void GetRNGstate(),PutRNGstate(); 
+  GetRNGstate();
+  uint64_t seed = counterRNG ? seedCounterRNG() : 0;
+
+  // ** prepare
+  int nTime = iid.n_rows;
+  arma::mat valueP = value.t(); // (nContrast, nTime)
+  if(alternative==3){
+	valueP = abs(valueP);
+  }
+  // observed statistics of the KS, CvM and sum tests
+  arma::rowvec SvalueKS, SvalueCvM, SvalueSum;
+  if(alternative==1){
+	SvalueKS = min(value,0);
+	SvalueSum = sum(value,0);
+  }else if(alternative==2){
+	SvalueKS = max(value,0);
+	SvalueSum = sum(value,0);
+  }else{
+	SvalueKS = max(abs(value),0);
+	SvalueSum = abs(sum(value,0));
+  }
+  SvalueCvM = sum(value % value, 0);
+
+  arma::mat Mstore(nSim, nContrast); // simulated extreme statistic (quantile)
+  arma::mat pmat(nContrast,nTime,arma::fill::zeros); // adjusted p-values
+  arma::mat ptest(3,nContrast,arma::fill::zeros); // KS, CvM and sum tests
+  int nBlock = sizeBlockProcess(blockSize, nSim, nSample, nTime, nContrast);
+  int nBlocks = (nSim + nBlock - 1) / nBlock;
+
+  // ** simulation
+#ifdef _OPENMP
+#pragma omp parallel if(counterRNG && ncores > 1) num_threads(ncores > 0 ? ncores : 1)
+#endif
+  {
+  arma::mat G; // individual weights (nSample, nBlock)
+  arma::cube iidGblock; // temporary curves (nTime, nBlock, nContrast)
+  arma::mat pmatThread(nContrast,nTime,arma::fill::zeros);
+  arma::mat ptestThread(3,nContrast,arma::fill::zeros);
+  arma::rowvec statKS(nContrast), statCvM(nContrast), statSum(nContrast);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+  for(int iBlock=0; iBlock<nBlocks; iBlock++){ 
+	int iSim0 = iBlock * nBlock;
+	int nSimBlock = std::min(nBlock, nSim - iSim0);
+	simulateBlockProcess(iid, iSim0, nSimBlock, counterRNG, seed, G, iidGblock);
+
+	for(int iSimBlock=0; iSimBlock<nSimBlock; iSimBlock++){ 
+	  int iSim = iSim0 + iSimBlock;
+	  for (int iC = 0; iC < nContrast; iC++) {
+		arma::colvec iidG = iidGblock.slice(iC).col(iSimBlock);
+		if(alternative==1){
+		  Mstore(iSim,iC) = iidG.min();
+		}else if(alternative==2){
+		  Mstore(iSim,iC) = iidG.max();
+		}else{
+		  Mstore(iSim,iC) = abs(iidG).max();
+		}
+		statKS(iC) = Mstore(iSim,iC) - SvalueKS(iC);
+		statCvM(iC) = sum(iidG % iidG) - SvalueCvM(iC);
+		if(alternative==1){
+		  statSum(iC) = - (sum(iidG) - SvalueSum(iC));
+		}else if(alternative==2){
+		  statSum(iC) = sum(iidG) - SvalueSum(iC);
+		}else{
+		  statSum(iC) = std::abs(sum(iidG)) - SvalueSum(iC);
+		}
+	  }
+	  if(global){ // take the more extreme statistic (over contrasts)
+		if(alternative==1){ 
+		  Mstore.row(iSim).fill(Mstore.row(iSim).min()); 
+		}else{
+		  Mstore.row(iSim).fill(Mstore.row(iSim).max()); 
+		}
+		statKS.fill(statKS.max());
+		statCvM.fill(statCvM.max());
+		statSum.fill(statSum.max());
+	  }
+
+	  for (int iC = 0; iC < nContrast; iC++) {
+		// adjusted p-values
+		double iEx = Mstore(iSim,iC);
+		for (int iT = 0; iT < nTime; iT++) {
+		  if(alternative == 1){
+			if(iEx <= valueP(iC,iT)){
+			  pmatThread(iC,iT)++ ;
+			}
+		  }else{
+			if(iEx >= valueP(iC,iT)){
+			  pmatThread(iC,iT)++ ;
+			}
+		  }
+		}
+		// tests
+		if(statKS(iC) > 0){ ptestThread(0,iC)++ ; }
+		if(statCvM(iC) > 0){ ptestThread(1,iC)++ ; }
+		if(statSum(iC) > 0){ ptestThread(2,iC)++ ; }
+	  }
+	}
+  }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+  {
+  pmat += pmatThread;
+  ptest += ptestThread;
+  }
+  }
+
+  // ** compute quantile
+  NumericVector Vquantile(nContrast, NA_REAL);
+  if(!R_IsNA(confLevel)){
+	int indexQuantile;
+	if(alternative==1){
+	  indexQuantile = round(nSim * (1-confLevel));
+	}else{
+	  indexQuantile = round(nSim * confLevel);
+	}
+	for (int iCol = 0; iCol < nContrast; iCol++){
+	  double* tempo = Mstore.colptr(iCol);
+	  std::nth_element(tempo, tempo + indexQuantile, tempo + nSim);
+	  Vquantile[iCol] = tempo[indexQuantile];
+	}
+  }
+
+  PutRNGstate();
+
+  return(List::create(Named("quantile") = Vquantile,
+					  Named("p.value") = pmat / nSim,
+					  Named("p.KS") = conv_to<std::vector<double> >::from(ptest.row(0) / nSim),
+					  Named("p.CvM") = conv_to<std::vector<double> >::from(ptest.row(1) / nSim),
+					  Named("p.sum") = conv_to<std::vector<double> >::from(ptest.row(2) / nSim)));
+}
+
+// * lowRankProcess_cpp
+// Reduce the influence function to an equivalent one in a smaller number of "observations":
+// the simulated processes iid * G with G ~ N(0,I_nSample) are Gaussian with covariance A A^t
+// where A (nTime*nContrast, nSample) stacks the contrasts. With the eigen-decomposition A A^t = Q D Q^t,
+// L = Q D^{1/2} (nTime*nContrast, rank) satisfies L L^t = A A^t, so simulating L * Z with Z ~ N(0,I_rank)
+// gives the same processes at a cost which does not depend on nSample.
+// iid: influence function (nTimes, nSample, nContrast)
+// rank: maximal number of eigenvectors to keep (0 or negative: all eigenvectors with a non-negligible eigenvalue)
+// tol: eigenvalues below tol times the largest eigenvalue are neglected
+// Returns a cube (nTimes, rank, nContrast) to be used as iid (with nSample = rank) in quantileProcess_cpp, pProcess_cpp, and sampleMaxProcess_cpp.
+// [[Rcpp::export]]
+arma::cube lowRankProcess_cpp(arma::cube& iid, int rank, double tol = 1e-12){
+  int nTime = iid.n_rows;
+  int nContrast = iid.n_slices;
+  int nStack = nTime * nContrast;
+
+  // ** Gram matrix of the stacked influence function
+  arma::mat K(nStack, nStack);
+  for(int iC=0; iC<nContrast; iC++){
+	for(int iC2=0; iC2<=iC; iC2++){
+	  arma::mat Kblock = iid.slice(iC) * iid.slice(iC2).t();
+	  K.submat(iC*nTime, iC2*nTime, (iC+1)*nTime-1, (iC2+1)*nTime-1) = Kblock;
+	  K.submat(iC2*nTime, iC*nTime, (iC2+1)*nTime-1, (iC+1)*nTime-1) = Kblock.t();
+	}
+  }
+
+  // ** eigen-decomposition (eigenvalues in increasing order)
+  arma::vec eigval;
+  arma::mat eigvec;
+  if(!arma::eig_sym(eigval, eigvec, K)){
+	throw std::runtime_error("Eigen-decomposition of the covariance of the influence function failed.");
+  }
+  double threshold = tol * std::max(eigval.max(), 0.0);
+  int nKeep = 0;
+  for(int i=nStack-1; i>=0; i--){
+	if(eigval[i] > threshold && (rank <= 0 || nKeep < rank)){
+	  nKeep++;
+	}else{
+	  break;
+	}
+  }
+  nKeep = std::max(nKeep, 1);
+
+  // ** reduced influence function
+  arma::cube out(nTime, nKeep, nContrast);
+  for(int iK=0; iK<nKeep; iK++){
+	int index = nStack-1-iK;
+	arma::vec L = eigvec.col(index) * sqrt(std::max(eigval[index], 0.0));
+	for(int iC=0; iC<nContrast; iC++){
+	  out.slice(iC).col(iK) = L.subvec(iC*nTime, (iC+1)*nTime-1);
+	}
+  }
+  return(out);
+}
+
+// * sizeBlockProcess
+// number of simulations performed at once
+int sizeBlockProcess(int blockSize, int nSim, int nSample, int nTime, int nContrast){
+  if(blockSize <= 0){ // automatic: at most 256 simulations and about 8Mb per block matrix
+	double nPerSim = std::max(nSample, nTime * nContrast);
+	blockSize = (int) std::min(256.0, std::max(1.0, 1e6 / nPerSim));
+  }
+  return(std::max(1, std::min(blockSize, nSim)));
+}
+
+// * simulateBlockProcess
+// simulate the processes of the simulations iSim0, ..., iSim0+nBlock-1:
+// draw the multipliers G (nSample, nBlock) and compute iidG (nTime, nBlock, nContrast)
+// with one matrix product per contrast.
+// The multipliers are drawn column by column, i.e. in the same order as one rnorm per simulation.
+void simulateBlockProcess(const arma::cube& iid, int iSim0, int nBlock, bool counterRNG, uint64_t seed,
+						  arma::mat& G, arma::cube& iidG){
+  int nSample = iid.n_cols;
+  G.set_size(nSample, nBlock);
+  for(int iSim=0; iSim<nBlock; iSim++){
+	if(counterRNG){
+	  arma::colvec Gcol(G.colptr(iSim), nSample, false, true);
+	  counterRnorm(Gcol, seed, iSim0 + iSim);
+	}else{
+	  for(int i=0; i<nSample; i++){
+		G(i,iSim) = R::norm_rand();
+	  }
+	}
+  }
+  iidG.set_size(iid.n_rows, nBlock, iid.n_slices);
+  for(unsigned int iC=0; iC<iid.n_slices; iC++){
+	iidG.slice(iC) = iid.slice(iC) * G;
+  }
+}
+
+// * pushHeapProcess
+// keep the nKeep largest values (min-heap) or the nKeep smallest values (max-heap)
+void pushHeapProcess(std::vector<double>& heap, double x, int nKeep, bool keepLargest){
+  if(nKeep <= 0){
+	return;
+  }
+  if(keepLargest){
+	if((int) heap.size() < nKeep){
+	  heap.push_back(x);
+	  std::push_heap(heap.begin(), heap.end(), std::greater<double>());
+	}else if(x > heap.front()){
+	  std::pop_heap(heap.begin(), heap.end(), std::greater<double>());
+	  heap.back() = x;
+	  std::push_heap(heap.begin(), heap.end(), std::greater<double>());
+	}
+  }else{
+	if((int) heap.size() < nKeep){
+	  heap.push_back(x);
+	  std::push_heap(heap.begin(), heap.end());
+	}else if(x < heap.front()){
+	  std::pop_heap(heap.begin(), heap.end());
+	  heap.back() = x;
+	  std::push_heap(heap.begin(), heap.end());
+	}
+  }
+}
+
+// * seedCounterRNG
+// draw the key of the counter-based generator from the random number generator of R
+// (GetRNGstate must have been called)
+uint64_t seedCounterRNG(){
+  uint64_t high = (uint64_t) (unif_rand() * 4294967296.0);
+  uint64_t low = (uint64_t) (unif_rand() * 4294967296.0);
+  return((high << 32) | low);
+}
+
+// * counterRnorm
+// standard normal multipliers of simulation iSim obtained by hashing (seed, iSim, index)
+// with the splitmix64 finalizer and applying the Box-Muller transform.
+// No state is shared between simulations, so this is thread safe.
+inline uint64_t splitmix64(uint64_t x){
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return(x ^ (x >> 31));
+}
+
+void counterRnorm(arma::colvec& G, uint64_t seed, uint64_t iSim){
+  int n = G.n_elem;
+  uint64_t key = splitmix64(seed ^ splitmix64(iSim));
+  const double twoPi = 6.283185307179586476925286766559;
+  for(int i=0; i<n; i+=2){
+	uint64_t h1 = splitmix64(key + (uint64_t) i);
+	uint64_t h2 = splitmix64(key + (uint64_t) i + 1);
+	double u1 = ((h1 >> 11) + 0.5) * (1.0/9007199254740992.0); // in (0,1)
+	double u2 = (h2 >> 11) * (1.0/9007199254740992.0); // in [0,1)
+	double r = sqrt(-2.0 * log(u1));
+	G[i] = r * cos(twoPi * u2);
+	if(i+1<n){
+	  G[i+1] = r * sin(twoPi * u2);
+	}
+  }
+}
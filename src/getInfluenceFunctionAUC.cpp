@@ -4,8 +4,78 @@
 using namespace Rcpp;
 using namespace arma;
 
+void weightsAUC(const NumericVector& time,
+                const NumericVector& status,
+                int firsthit,
+                const NumericVector& GTiminus,
+                const NumericVector& Gtau,
+                NumericVector& weights,
+                LogicalVector& cases,
+                LogicalVector& controls1,
+                LogicalVector& controls2,
+                double& muCase,
+                double& muControls);
+
+void IC0AUCGivenWeights(const NumericVector& time,
+                        const NumericVector& status,
+                        double tau,
+                        const NumericVector& risk,
+                        const IntegerVector& ordering,
+                        const NumericVector& weights,
+                        const LogicalVector& cases,
+                        const LogicalVector& controls1,
+                        const LogicalVector& controls2,
+                        double muCase,
+                        double muControls,
+                        double auc,
+                        NumericVector& ic0,
+                        NumericVector& ic0Case,
+                        NumericVector& ic0Control,
+                        double& nu);
+
+void IC0AUC(const NumericVector& time,
+            const NumericVector& status,
+            double tau,
+            int firsthit,
+            const NumericVector& risk,
+            const IntegerVector& ordering,
+            const NumericVector& GTiminus,
+            const NumericVector& Gtau,
+            double auc,
+            NumericVector& ic0,
+            NumericVector& ic0Case,
+            NumericVector& ic0Control,
+            NumericVector& weights,
+            LogicalVector& cases,
+            LogicalVector& controls1,
+            LogicalVector& controls2,
+            double& muCase,
+            double& muControls,
+            double& nu);
+
+NumericVector AUCKMCensoringTerm(const NumericVector& time,
+                                 const NumericVector& status,
+                                 double tau,
+                                 const NumericVector& ic0Case,
+                                 const NumericVector& ic0Controls,
+                                 const NumericVector& weights,
+                                 int firsthit,
+                                 double muCase,
+                                 double muControls,
+                                 double nu1,
+                                 double Gtau,
+                                 int startControls1,
+                                 const arma::vec& atrisk,
+                                 const arma::vec& MC_term2,
+                                 const arma::uvec& sindex,
+                                 const arma::vec& utime);
+
+IntegerVector orderRisk(const NumericVector& risk);
+
 // part of IFAUC without the influence function from the censoring
 // author: Johan Sebastian Ohlendorff
+// index (optional, starts at 1): observations forming the dataset, e.g. a bootstrap sample (time[index] must be sorted).
+//        time, status, risk, GTiminus and Gtau are copied for these observations, i.e. one copy of the resampled data per call.
 // [[Rcpp::export(rng = false)]]
 List getIC0AUC(NumericVector time,
                         NumericVector status,
@@ -13,7 +83,22 @@ List getIC0AUC(NumericVector time,
                         NumericVector risk,
                         NumericVector GTiminus,
                         NumericVector Gtau,
-                        double auc) {
+                        double auc,
+                        Nullable<IntegerVector> index = R_NilValue) {
+  if(index.isNotNull()){
+    IntegerVector index0 = IntegerVector(index) - 1;
+    int nAll = time.size();
+    for(int i = 0; i < index0.size(); i++){
+      if(index0[i] < 0 || index0[i] >= nAll || (i > 0 && time[index0[i]] < time[index0[i-1]])){
+        stop("Argument 'index' should contain integers between 1 and %i such that time[index] is sorted.", nAll);
+      }
+    }
+    time = time[index0];
+    status = status[index0];
+    risk = risk[index0];
+    GTiminus = GTiminus[index0];
+    Gtau = Gtau[index0];
+  }
   int n = time.size();
   NumericVector ic0(n), ic0Case(n), ic0Control(n), weights(n);
   LogicalVector cases(n), controls1(n), controls2(n);
@@ -26,6 +111,79 @@ List getIC0AUC(NumericVector time,
     firsthit = 0;
   }
 
+  IntegerVector ordering = orderRisk(risk);
+  IC0AUC(time,status,tau,firsthit,risk,ordering,GTiminus,Gtau,auc,
+         ic0,ic0Case,ic0Control,weights,cases,controls1,controls2,muCase,muControls,nu);
+  return(List::create(Named("ic0") = ic0,
+                      Named("ic0Case") = ic0Case[cases],
+                      Named("ic0Control") = ic0Control[controls1 | controls2],
+                      Named("weights") = weights,
+                      Named("muCase") = muCase,
+                      Named("muControls") = muControls,
+                      Named("nu") = nu,
+                      Named("firsthit")=firsthit,
+                      Named("cases")=cases,
+                      Named("controls")=controls1 | controls2,
+                      Named("controls1")=controls1,
+                      Named("controls2")=controls2));
+}
+
+// order of the subjects by increasing risk
+IntegerVector orderRisk(const NumericVector& risk){
+  int n = risk.size();
+  IntegerVector ordering(n);
+  std::iota(ordering.begin(), ordering.end(), 0);
+  std::sort(ordering.begin(), ordering.end(),
+            [&](int x, int y) { return risk[x] < risk[y]; });
+  return ordering;
+}
+
+// ic0 of the AUC at horizon tau given the ordering of the subjects by risk
+// firsthit: last subject with time <= tau (0 if there is none)
+void IC0AUC(const NumericVector& time,
+            const NumericVector& status,
+            double tau,
+            int firsthit,
+            const NumericVector& risk,
+            const IntegerVector& ordering,
+            const NumericVector& GTiminus,
+            const NumericVector& Gtau,
+            double auc,
+            NumericVector& ic0,
+            NumericVector& ic0Case,
+            NumericVector& ic0Control,
+            NumericVector& weights,
+            LogicalVector& cases,
+            LogicalVector& controls1,
+            LogicalVector& controls2,
+            double& muCase,
+            double& muControls,
+            double& nu){
+  weightsAUC(time,status,firsthit,GTiminus,Gtau,weights,cases,controls1,controls2,muCase,muControls);
+  IC0AUCGivenWeights(time,status,tau,risk,ordering,weights,cases,controls1,controls2,muCase,muControls,auc,
+                     ic0,ic0Case,ic0Control,nu);
+}
+
+// case/control sets and weights at horizon tau (they do not depend on the risks)
+// firsthit: last subject with time <= tau (0 if there is none)
+void weightsAUC(const NumericVector& time,
+                const NumericVector& status,
+                int firsthit,
+                const NumericVector& GTiminus,
+                const NumericVector& Gtau,
+                NumericVector& weights,
+                LogicalVector& cases,
+                LogicalVector& controls1,
+                LogicalVector& controls2,
+                double& muCase,
+                double& muControls){
+  int n = time.size();
+  std::fill(weights.begin(),weights.end(),0.0);
+  std::fill(cases.begin(),cases.end(),false);
+  std::fill(controls1.begin(),controls1.end(),false);
+  std::fill(controls2.begin(),controls2.end(),false);
+  muCase = muControls = 0;
+
   // calculate weights W_t(G;Z_i) = I(status_i != 0, time <= tau) 1/G(Ti-|Xi) + I(time > tau) 1/G(Ti-|Xi) 
   // also calculate muCase = sum_i W_t(G;Z_i) over cases and muControls = sum_i W_t(G;Z_i) over controls
   for (int i = 0; i <= firsthit; i++){
@@ -45,13 +203,29 @@ List getIC0AUC(NumericVector time,
     weights[i] = 1.0/Gtau[i];
     muControls += weights[i];
   }
+}
+
+// ic0 of the AUC at horizon tau given the ordering of the subjects by risk and the output of weightsAUC
+void IC0AUCGivenWeights(const NumericVector& time,
+                        const NumericVector& status,
+                        double tau,
+                        const NumericVector& risk,
+                        const IntegerVector& ordering,
+                        const NumericVector& weights,
+                        const LogicalVector& cases,
+                        const LogicalVector& controls1,
+                        const LogicalVector& controls2,
+                        double muCase,
+                        double muControls,
+                        double auc,
+                        NumericVector& ic0,
+                        NumericVector& ic0Case,
+                        NumericVector& ic0Control,
+                        double& nu){
+  int n = time.size();
   double mu = muCase*muControls / (double (n*n));
   nu = auc * mu;
 
-  IntegerVector ordering(n);
-  std::iota(ordering.begin(), ordering.end(), 0);
-  std::sort(ordering.begin(), ordering.end(),
-            [&](int x, int y) { return risk[x] < risk[y]; });
   double valCurr{}, valPrev{};
   int i = n-1;
   while (i >= 0){
@@ -113,21 +287,10 @@ List getIC0AUC(NumericVector time,
     }
     ic0[i] = (IF0num * mu - IF0den * nu)/(mu*mu);
   }
-  return(List::create(Named("ic0") = ic0,
-                      Named("ic0Case") = ic0Case[cases],
-                      Named("ic0Control") = ic0Control[controls1 | controls2],
-                      Named("weights") = weights,
-                      Named("muCase") = muCase,
-                      Named("muControls") = muControls,
-                      Named("nu") = nu,
-                      Named("firsthit")=firsthit,
-                      Named("cases")=cases,
-                      Named("controls")=controls1 | controls2,
-                      Named("controls1")=controls1,
-                      Named("controls2")=controls2));
 }
 
 // calculate the term corresponding to KM censoring
+// KM: optional output of getInfluenceFunctionKMStructure, to avoid recomputing the Kaplan-Meier ingredients
 // author: Johan Sebastian Ohlendorff
 // [[Rcpp::export(rng = false)]]
 NumericVector getInfluenceFunctionAUCKMCensoringTerm(NumericVector time,
@@ -142,17 +305,36 @@ NumericVector getInfluenceFunctionAUCKMCensoringTerm(NumericVector time,
                                                      double nu1,
                                                      double Gtau,
                                                      double auc, 
-                                                     int startControls1) {
+                                                     int startControls1,
+                                                     Nullable<List> KM = R_NilValue) {
+  arma::uvec sindex;
+  arma::vec utime, atrisk, MC_term2;
+  getInfluenceFunctionKM(time,status,KM,atrisk,MC_term2,sindex,utime);
+  return(AUCKMCensoringTerm(time,status,tau,ic0Case,ic0Controls,weights,firsthit,muCase,muControls,nu1,Gtau,
+                            startControls1,atrisk,MC_term2,sindex,utime));
+}
+
+// term corresponding to KM censoring given the Kaplan-Meier ingredients (see getInfluenceFunctionKM)
+NumericVector AUCKMCensoringTerm(const NumericVector& time,
+                                 const NumericVector& status,
+                                 double tau,
+                                 const NumericVector& ic0Case,
+                                 const NumericVector& ic0Controls,
+                                 const NumericVector& weights,
+                                 int firsthit,
+                                 double muCase,
+                                 double muControls,
+                                 double nu1,
+                                 double Gtau,
+                                 int startControls1,
+                                 const arma::vec& atrisk,
+                                 const arma::vec& MC_term2,
+                                 const arma::uvec& sindex,
+                                 const arma::vec& utime){
   // Thomas' code from IC of Nelson-Aalen estimator, i.e. calculate the influence function of the hazard
   // initialize first time point t=0 with data of subject i=0
   int n = time.size();
   NumericVector icpart(n);
-  arma::uvec sindex(n,fill::zeros);
-  arma::vec utime=unique(time);
-  int nu=utime.size();
-  arma::vec atrisk(nu);
-  arma::vec MC_term2(nu,fill::zeros);
-  getInfluenceFunctionKM(time,status,atrisk,MC_term2,sindex,utime);
   double term2numpart1{}, term2denpart1{};
   double term2numpart2 = nu1 * (double (n*n)); //{}, term3num{}, term2denpart2{}, term3den{};
   double term2denpart2 = muCase;
@@ -235,3 +417,125 @@ NumericVector getInfluenceFunctionAUCKMCensoringTerm(NumericVector time,
   }
   return icpart;
 }
+
+// AUC, ROC curve and influence function of the AUC for several models and horizons in one call.
+// time must be sorted in increasing order and tau in increasing order.
+// risk: one column per model and horizon, the horizon varying fastest (column m*nTau+k for model m and horizon k)
+// Gtau: one column per horizon
+// The AUC is the area under the ROC curve (trapezoidal rule over the distinct risks), and the influence function is centered at it.
+// The case/control sets and weights are derived once per horizon for all models, the risks of a model are only
+// re-ordered when the ordering of its previous horizon is not valid anymore, and the Kaplan-Meier ingredients
+// are derived once per call (or taken from KM when it matches the data).
+// iid: should the influence function be computed? (otherwise only the AUC and the ROC curve)
+// conservative: ignore the estimation of the censoring weights (otherwise add the Kaplan-Meier censoring term)
+// KM: optional output of getInfluenceFunctionKMStructure
+// [[Rcpp::export(rng = false)]]
+List getInfluenceFunctionAUCKM(NumericVector time,
+                               NumericVector status,
+                               NumericVector tau,
+                               NumericMatrix risk,
+                               NumericVector GTiminus,
+                               NumericMatrix Gtau,
+                               bool iid,
+                               bool conservative,
+                               Nullable<List> KM = R_NilValue) {
+  int n = time.size();
+  int nTau = tau.size();
+  if (nTau == 0 || Gtau.ncol() != nTau || risk.ncol() % nTau != 0){
+    stop("Incompatible dimensions: risk should have one column per model and horizon and Gtau one column per horizon.");
+  }
+  if (!std::is_sorted(time.begin(),time.end()) || !std::is_sorted(tau.begin(),tau.end())){
+    stop("Times and horizons should be sorted in increasing order.");
+  }
+  int nModel = risk.ncol() / nTau;
+  NumericVector auc(risk.ncol());
+  NumericMatrix IF(iid ? n : 0, risk.ncol());
+  List ROC(risk.ncol());
+  NumericVector ic0(n), ic0Case(n), ic0Control(n), weights(n);
+  LogicalVector cases(n), controls1(n), controls2(n);
+  double muCase{}, muControls{}, nu{};
+  std::vector<IntegerVector> ordering(nModel);
+  int nSort = 0;
+
+  // Kaplan-Meier ingredients, shared by all models and horizons
+  arma::uvec sindex;
+  arma::vec utime, atrisk, MC_term2;
+  if (iid && !conservative && n > 0){
+    getInfluenceFunctionKM(time,status,KM,atrisk,MC_term2,sindex,utime);
+  }
+
+  int iHit = -1;
+  for (int k = 0; k < nTau; k++){
+    // time sweep: last subject with time <= tau
+    while (iHit+1 < n && time[iHit+1] <= tau[k]){
+      iHit++;
+    }
+    int firsthit = iHit == -1 ? 0 : iHit;
+    NumericVector GtauK = Gtau(_,k);
+    weightsAUC(time,status,firsthit,GTiminus,GtauK,weights,cases,controls1,controls2,muCase,muControls);
+    bool conservativeK = conservative || n == 0 || tau[k] >= time[n-1];
+
+    for (int m = 0; m < nModel; m++){
+      int iCol = m*nTau+k;
+      NumericVector riskCol = risk(_,iCol);
+      // re-use the ordering of the previous horizon when it still sorts the risks
+      bool sorted = ordering[m].size() == n;
+      for (int i = 1; sorted && i < n; i++){
+        sorted = riskCol[ordering[m][i-1]] <= riskCol[ordering[m][i]];
+      }
+      if (!sorted){
+        ordering[m] = orderRisk(riskCol);
+        nSort++;
+      }
+      const IntegerVector& order = ordering[m];
+
+      // ROC curve: one point per distinct risk (decreasing), and AUC by the trapezoidal rule
+      std::vector<double> rocRisk, rocTPR, rocFPR;
+      double sumCase{}, sumControl{}, TPRprev{}, FPRprev{}, area{};
+      int i = n-1;
+      while (i >= 0){
+        int tieIter = i;
+        while (tieIter >= 0 && riskCol[order[tieIter]]==riskCol[order[i]]){
+          if (cases[order[tieIter]]){
+            sumCase += weights[order[tieIter]];
+          }
+          else if (controls1[order[tieIter]] || controls2[order[tieIter]]){
+            sumControl += weights[order[tieIter]];
+          }
+          tieIter--;
+        }
+        double TPR = sumCase/muCase;
+        double FPR = sumControl/muControls;
+        area += (FPR-FPRprev)*(TPRprev+TPR)/2.0;
+        rocRisk.push_back(riskCol[order[i]]);
+        rocTPR.push_back(TPR);
+        rocFPR.push_back(FPR);
+        TPRprev = TPR;
+        FPRprev = FPR;
+        i = tieIter;
+      }
+      auc[iCol] = area;
+      ROC[iCol] = List::create(Named("risk") = wrap(rocRisk),
+                               Named("TPR") = wrap(rocTPR),
+                               Named("FPR") = wrap(rocFPR));
+
+      if (iid){
+        IC0AUCGivenWeights(time,status,tau[k],riskCol,order,weights,cases,controls1,controls2,muCase,muControls,auc[iCol],
+                           ic0,ic0Case,ic0Control,nu);
+        // Kaplan-Meier censoring term
+        int nControls2 = sum(controls2);
+        if (!conservativeK && (sum(controls1) + nControls2) > 0){
+          IF(_,iCol) = ic0 + AUCKMCensoringTerm(time,status,tau[k],ic0Case[cases],ic0Control[controls1 | controls2],
+                                                weights,firsthit,muCase,muControls,nu,GtauK[0],nControls2,
+                                                atrisk,MC_term2,sindex,utime);
+        }else{
+          IF(_,iCol) = ic0;
+        }
+      }
+    }
+  }
+  return(List::create(Named("AUC") = auc,
+                      Named("ROC") = ROC,
+                      Named("IF") = IF,
+                      Named("nSort") = nSort));
+}
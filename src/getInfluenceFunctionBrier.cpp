@@ -8,19 +8,18 @@ using namespace arma;
 // Calculate influence function for competing risk case/survival case with Nelson-Aalen censoring.
 // see https://github.com/eestet75/riskRegressionStudy/blob/master/PicsForImplementation/BrierTrainTest.png
 // Should be used with loob estimates and generally 
+// KM: optional output of getInfluenceFunctionKMStructure, to avoid recomputing the Kaplan-Meier ingredients
 // [[Rcpp::export(rng=false)]]
 NumericVector getInfluenceFunctionBrierKMCensoringTerm(double tau,
                                                              NumericVector time,
                                                              NumericVector residuals,
-                                                             NumericVector status) {
+                                                             NumericVector status,
+                                                             Nullable<List> KM = R_NilValue) {
   int n = time.size();
   NumericVector ictermvec(n);
-  arma::uvec sindex(n,fill::zeros);
-  arma::vec utime=unique(time);
-  int nu=utime.size();
-  arma::vec atrisk(nu);
-  arma::vec MC_term2(nu,fill::zeros);
-  getInfluenceFunctionKM(time,status,atrisk,MC_term2,sindex,utime);
+  arma::uvec sindex;
+  arma::vec utime, atrisk, MC_term2;
+  getInfluenceFunctionKM(time,status,KM,atrisk,MC_term2,sindex,utime);
   
   // find first index such that k such that tau[k] <= tau but tau[k+1] > tau
   // find first index such that k such that tau[k] <= tau but tau[k+1] > tau
@@ -82,3 +81,121 @@ NumericVector getInfluenceFunctionBrierKMCensoringTerm(double tau,
   }
   return ictermvec;
 }
+
+// Same as getInfluenceFunctionBrierKMCensoringTerm for several models and horizons at once:
+// column k of residuals is associated with horizon tau[k].
+// The Kaplan-Meier ingredients are computed once and time is swept once for all columns.
+// [[Rcpp::export(rng=false)]]
+NumericMatrix getInfluenceFunctionBrierKMCensoringTermMultipleTimes(NumericVector tau,
+                                                                    NumericVector time,
+                                                                    NumericMatrix residuals,
+                                                                    NumericVector status,
+                                                                    Nullable<List> KM = R_NilValue) {
+  int n = time.size();
+  int K = residuals.ncol();
+  if(residuals.nrow() != n){
+    stop("Argument \'residuals\' should have as many rows as the length of argument \'time\'.");
+  }
+  if(tau.size() != K){
+    stop("Argument \'tau\' should have one element per column of argument \'residuals\'.");
+  }
+  NumericMatrix ictermmat(n,K);
+  arma::uvec sindex;
+  arma::vec utime, atrisk, MC_term2;
+  getInfluenceFunctionKM(time,status,KM,atrisk,MC_term2,sindex,utime);
+
+  std::vector<int> firsthit(K);
+  std::vector<double> icpart1(K,0.0), icpart2(K,0.0), icpart(K,0.0);
+  for (int k = 0; k < K; k++){
+    // find first index such that k such that tau[k] <= tau but tau[k+1] > tau
+    auto lower = std::upper_bound(time.begin(), time.end(), tau[k]);
+    firsthit[k] = std::distance(time.begin(), lower) -1;
+    for (int i = 0; i < n; i++){
+      if (status[i] != 0 && time[i] <= tau[k]){
+        icpart2[k] += residuals(i,k);
+      }
+      else if (time[i] > tau[k]){
+        icpart[k] += residuals(i,k);
+      }
+    }
+    icpart[k] = icpart[k] / ( (double) n);
+  }
+  int tieIter = 0;
+  while ((tieIter < n) && (time[tieIter] == time[0])) {
+    if (status[tieIter]!=0){
+      for (int k = 0; k < K; k++){
+        if (time[tieIter] <= tau[k]){
+          icpart2[k] -= residuals(tieIter,k);
+        }
+      }
+    }
+    tieIter++;
+  }
+  int upperTie = tieIter-1;
+  double fihattau{}, fihattauI{};
+  int j;
+  for (int i = 0; i<n; i++){
+    // value when the horizon is after time[i]
+    fihattauI = (1-(status[i] != 0))*n/atrisk[sindex[i]]- MC_term2[sindex[i]];
+    for (int k = 0; k < K; k++){
+      if (i > firsthit[k]){
+        j = firsthit[k];
+      }
+      else {
+        j = i;
+      }
+      if (j==-1){
+        fihattau = 0.0;
+      }
+      else if (utime[sindex[j]] < time[i]){
+        fihattau = - MC_term2[sindex[j]];
+      }
+      else {
+        fihattau = fihattauI;
+      }
+      ictermmat(i,k) = 1.0 / n * (icpart1[k]+fihattau*icpart2[k]) + icpart[k] * fihattau;
+    }
+    if (upperTie == i){
+      int tieIter = i+1;
+      while ((tieIter < n) && (time[tieIter] == time[i+1])) {
+        if (status[tieIter]!=0){
+          for (int k = 0; k < K; k++){
+            if (time[tieIter] <= tau[k]){
+              icpart1[k] -= residuals(tieIter,k)*MC_term2[sindex[i]];
+              icpart2[k] -= residuals(tieIter,k);
+            }
+          }
+        }
+        tieIter++;
+      }
+      upperTie = tieIter-1;
+    }
+  }
+  return ictermmat;
+}
+
+// Kaplan-Meier ingredients of the influence function of the censoring distribution:
+// they only depend on the response and can be computed once (e.g. per call to Score)
+// and passed to the AUC and Brier kernels for all models and horizons.
+// time must be sorted in increasing order.
+// [[Rcpp::export(rng=false)]]
+List getInfluenceFunctionKMStructure(NumericVector time,
+                                     NumericVector status) {
+  int n = time.size();
+  arma::uvec sindex(n,fill::zeros);
+  arma::vec utime=unique(time);
+  int nu=utime.size();
+  arma::vec atrisk(nu);
+  arma::vec MC_term2(nu,fill::zeros);
+  getInfluenceFunctionKM(time,status,atrisk,MC_term2,sindex,utime);
+  // number of censored observations at each unique time: used to check that the structure matches the data
+  IntegerVector ncens(nu);
+  for (int i = 0; i < n; i++){
+    ncens[sindex[i]] += (status[i] == 0);
+  }
+  return(List::create(Named("atrisk") = atrisk,
+                      Named("MC_term2") = MC_term2,
+                      Named("sindex") = IntegerVector(sindex.begin(),sindex.end()),
+                      Named("utime") = utime,
+                      Named("ncens") = ncens));
+}
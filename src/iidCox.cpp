@@ -10,10 +10,42 @@ List calcE_cpp(const NumericVector& eventtime,
                const NumericVector& status,
                const NumericVector& eXb,
                const arma::mat& X,
-               int p, bool add0, bool reverse){
+               int p, bool add0, bool reverse,
+               Nullable<IntegerVector> multiplicity = R_NilValue){
   // reverse refer to the case where censoring happens before the event otherwise censoring is treated as happening after event
+  // multiplicity: number of times each observation should be counted (e.g. in a bootstrap sample)
   
   int nObs = eventtime.size();
+
+  if(multiplicity.isNotNull()){
+    // repeated observations are adjacent and share the same time and status:
+    // the resampled dataset is equivalent to the observations with positive multiplicity with eXb scaled by the multiplicity
+    IntegerVector nRep(multiplicity);
+    if(nRep.size() != nObs){
+      stop("Argument \'multiplicity\' should have length %i (number of observations). \n", nObs);
+    }
+    std::vector<arma::uword> indexKeep;
+    for(int iObs=0;iObs<nObs;iObs++){
+      if(nRep[iObs] == NA_INTEGER || nRep[iObs] < 0){
+        stop("Argument \'multiplicity\' should only contain non-negative integers. \n");
+      }
+      if(nRep[iObs] > 0){
+        indexKeep.push_back(iObs);
+      }
+    }
+    int nKeep = indexKeep.size();
+    NumericVector eventtimeKeep(nKeep), statusKeep(nKeep), eXbKeep(nKeep);
+    for(int iKeep=0;iKeep<nKeep;iKeep++){
+      eventtimeKeep[iKeep] = eventtime[indexKeep[iKeep]];
+      statusKeep[iKeep] = status[indexKeep[iKeep]];
+      eXbKeep[iKeep] = eXb[indexKeep[iKeep]] * nRep[indexKeep[iKeep]];
+    }
+    arma::mat XKeep;
+    if(p>0){
+      XKeep = X.rows(arma::uvec(indexKeep));
+    }
+    return(calcE_cpp(eventtimeKeep, statusKeep, eXbKeep, XKeep, p, add0, reverse, R_NilValue));
+  }
   
   // define times
   NumericVector t = eventtime[status>0];
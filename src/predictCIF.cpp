@@ -21,7 +21,23 @@ List predictCIF_cpp(const std::vector<arma::mat>& hazard,
                     bool survtype,
                     bool productLimit,
                     bool diag,
-                    bool exportSurv){
+                    bool exportSurv,
+                    Nullable<IntegerVector> index = R_NilValue){
+  // index (optional, starts at 1): rows of eXb, strata, etimeMax (and newtimes when diag is true)
+  //                                at which the predictions should be made, e.g. a bootstrap sample.
+  //                                Then nData should be the length of index.
+  IntegerVector indexData;
+  if(index.isNotNull()){
+    indexData = IntegerVector(index);
+    if(indexData.size() != nData){
+      stop("Argument \'index\' should have length %i (argument \'nData\') instead of %i. \n", nData, indexData.size());
+    }
+    for(int iterI=0 ; iterI<nData; iterI++){
+      if(indexData[iterI] == NA_INTEGER || indexData[iterI] < 1 || indexData[iterI] > (int)eXb.n_rows){
+        stop("Argument \'index\' should contain integers between 1 and %i (number of rows of argument \'eXb\'). \n", (int)eXb.n_rows);
+      }
+    }
+  }
   
   arma::mat pred_CIF;
   if (diag) {	
@@ -53,15 +69,16 @@ List predictCIF_cpp(const std::vector<arma::mat>& hazard,
   
   for(int iterI=0 ; iterI<nData; iterI++){ // index of the patient
     R_CheckUserInterrupt();
+    int iterD = index.isNotNull() ? indexData[iterI]-1 : iterI; // corresponding row in the data
     
     CIF_it = 0;
     iterP = 0;
     survival_it = 1;
-    strataI = strata.row(iterI);
+    strataI = strata.row(iterD);
     
     if(diag){
       iNNewTimes = 1;
-      iNewTimes[0] = newtimes[iterI];
+      iNewTimes[0] = newtimes[iterD];
     }else{
       iNNewTimes = nNewTimes;
       iNewTimes = newtimes;
@@ -69,7 +86,7 @@ List predictCIF_cpp(const std::vector<arma::mat>& hazard,
     for(int iterT=0 ; iterT<nEventTimes; iterT++){ // index of the time in the integral (event time number)
       // update position 
       while(iterP < iNNewTimes && iNewTimes[iterP]<etimes[iterT]){
-        if(iNewTimes[iterP] <= etimeMax[iterI]){
+        if(iNewTimes[iterP] <= etimeMax[iterD]){
           pred_CIF(iterI,iterP) = CIF_it;
         }
         iterP++;
@@ -77,12 +94,12 @@ List predictCIF_cpp(const std::vector<arma::mat>& hazard,
       
       // if CIF has been calculated for all patients no need to continue to loop
       // if the next prediction time is after the last event no need to continue (all NA)
-      if(iterP >= iNNewTimes || iNewTimes[iterP] > etimeMax[iterI]){
+      if(iterP >= iNNewTimes || iNewTimes[iterP] > etimeMax[iterD]){
         break;
       } 
       
       // get hazard for the cause of interest
-      hazard_it = hazard[cause](iterT,strataI[cause])*eXb(iterI,cause);
+      hazard_it = hazard[cause](iterT,strataI[cause])*eXb(iterD,cause);
       
       // sum all cumhazard for all causes times the linear predictor and then take the exponential
       if(iterT>0){ // it is survival at t- which is computed i.e. the survival at the previous eventtime (censoring does not affect survival)
@@ -90,11 +107,11 @@ List predictCIF_cpp(const std::vector<arma::mat>& hazard,
         if(productLimit){ // product limit - equivalent to mstate
           
           if(survtype){ // product limit 
-            survival_it *= (1-eXb(iterI,1)*hazard[1](iterT-1,strataI[1]));
+            survival_it *= (1-eXb(iterD,1)*hazard[1](iterT-1,strataI[1]));
           }else{	    
             hazard_tempo = 0;
             for(int iterC=0 ; iterC<nCause; iterC++){
-              hazard_tempo += eXb(iterI,iterC)*hazard[iterC](iterT-1,strataI[iterC]);
+              hazard_tempo += eXb(iterD,iterC)*hazard[iterC](iterT-1,strataI[iterC]);
             }
             survival_it *= (1-hazard_tempo);
           }
@@ -102,11 +119,11 @@ List predictCIF_cpp(const std::vector<arma::mat>& hazard,
         }else{
           
           if(survtype){
-            survival_it = exp(-cumhazard[1](iterT-1,strataI[1])*eXb(iterI,1));
+            survival_it = exp(-cumhazard[1](iterT-1,strataI[1])*eXb(iterD,1));
           }else{	     
             survival_it = 0; 
             for(int iterC=0 ; iterC<nCause; iterC++){
-              survival_it += cumhazard[iterC](iterT-1,strataI[iterC])*eXb(iterI,iterC);
+              survival_it += cumhazard[iterC](iterT-1,strataI[iterC])*eXb(iterD,iterC);
             }
             survival_it = exp(-survival_it);
           }
@@ -141,7 +158,7 @@ List predictCIF_cpp(const std::vector<arma::mat>& hazard,
       //> censored event are not in etimes thus prediction time after the last death and before the last censored event should be CIF_it and not NA
       //> prediction time exactly equal to the last event will not be assigned any value in the previous loop (because iNewTimes[iterP]<etimes[iterT]). It will be updated here.
       for(int iterPP = iterP; iterPP<iNNewTimes ; iterPP++){
-        if(iNewTimes[iterPP] <= etimeMax[iterI]){
+        if(iNewTimes[iterPP] <= etimeMax[iterD]){
           pred_CIF(iterI,iterPP) = CIF_it;  
         }else{
           break;
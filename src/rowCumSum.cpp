@@ -1,21 +1,246 @@
 // [[Rcpp::depends(RcppArmadillo)]]
 #include <RcppArmadillo.h>
+#include <algorithm>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 using namespace Rcpp;
 
 //' Apply cumsum in each row 
 //'
 //' @description Fast computation of t(apply(x,1,cumsum))
 //' @param x A matrix.
+//' @param inplace [logical] should the result be written in the memory of \code{x}?
+//' This avoids allocating a second matrix but modifies \code{x} (and any R object sharing its memory),
+//' so it should only be used on temporary matrices. Only effective when \code{x} is stored as double.
+//' @param ncores [integer] number of threads over which the blocks of rows are distributed (when compiled with OpenMP).
 //' @return A matrix of same size as x.
+//' @details The matrix is processed by blocks of rows: within a block the columns are visited one after the other,
+//' so that memory is read contiguously and the running sums of the block stay in cache.
 //' @author Thomas Alexander Gerds <tag@@biostat.ku.dk>
 //' @examples
 //' x <- matrix(1:8,ncol=2)
 //' rowCumSum(x)
+//'
+//' \dontrun{
+//' ## benchmark on a 1e5 x 1e4 matrix (8Gb per copy of the matrix)
+//' X <- matrix(rnorm(1e9), nrow = 1e5, ncol = 1e4)
+//' system.time(t(apply(X,1,cumsum)))
+//' system.time(rowCumSum(X))
+//' system.time(rowCumSum(X, ncores = 4))
+//' system.time(rowCumSum(X, inplace = TRUE, ncores = 4)) ## X now contains the result
+//' }
+//' @export
+// [[Rcpp::export]]
+NumericMatrix rowCumSum(NumericMatrix x, bool inplace = false, int ncores = 1){
+  int n = x.nrow(), p = x.ncol();
+  NumericMatrix result = inplace ? x : NumericMatrix(Rcpp::no_init(n, p));
+  const double* X = x.begin();
+  double* R = result.begin();
+  const int blockSize = 512; // 4Kb of running sums per block
+  int nBlock = (n + blockSize - 1) / blockSize;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(ncores > 0 ? ncores : 1) if(nBlock > 1)
+#endif
+  for(int iBlock=0; iBlock<nBlock; iBlock++){
+    int iStart = iBlock * blockSize;
+    int iSize = std::min(blockSize, n - iStart);
+    if(p == 0){
+      continue;
+    }
+    const double* iX = X + iStart;
+    double* iR = R + iStart;
+    double* iPrev = iR;
+    for(int iRow=0; iRow<iSize; iRow++){
+      iR[iRow] = iX[iRow];
+    }
+    for(int iCol=1; iCol<p; iCol++){
+      iX += n;
+      iR += n;
+      for(int iRow=0; iRow<iSize; iRow++){
+        iR[iRow] = iPrev[iRow] + iX[iRow];
+      }
+      iPrev = iR;
+    }
+  }
+  return result;
+}
+
+// * RowCumSumView
+// Cumulative sums over the columns of a matrix, evaluated lazily:
+// only the increments (the matrix itself, not copied) are stored,
+// and the cumulative sums are computed at the requested columns when needed.
+// Column indexes are 1-based, 0 corresponds to an empty sum (i.e. 0) and NA to NA.
+class RowCumSumView {
+public:
+  RowCumSumView(const NumericMatrix& x) : X(x.begin()), n(x.nrow()), p(x.ncol()) {}
+
+  // out[i + k*n] = sum(x[i,1:index[k]]): one pass over the first max(index) columns
+  void evalColumns(const IntegerVector& index, double* out, int ncores) const {
+    int nIndex = index.size();
+    int maxIndex = checkIndex(index);
+    // position in the output of the columns requested at each column of x
+    std::vector<std::vector<int> > position(maxIndex+1);
+    for(int k=0; k<nIndex; k++){
+      if(index[k] == NA_INTEGER){
+        std::fill(out + (size_t)k * n, out + (size_t)(k+1) * n, NA_REAL);
+      }else{
+        position[index[k]].push_back(k);
+      }
+    }
+    const int blockSize = 512;
+    int nBlock = (n + blockSize - 1) / blockSize;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(ncores > 0 ? ncores : 1) if(nBlock > 1)
+#endif
+    for(int iBlock=0; iBlock<nBlock; iBlock++){
+      int iStart = iBlock * blockSize;
+      int iSize = std::min(blockSize, n - iStart);
+      std::vector<double> iSum(iSize, 0.0);
+      for(int iCol=0; iCol<=maxIndex; iCol++){
+        if(iCol>0){
+          const double* iX = X + (size_t)(iCol-1) * n + iStart;
+          for(int iRow=0; iRow<iSize; iRow++){
+            iSum[iRow] += iX[iRow];
+          }
+        }
+        for(size_t iK=0; iK<position[iCol].size(); iK++){
+          std::copy(iSum.begin(), iSum.end(), out + (size_t)position[iCol][iK] * n + iStart);
+        }
+      }
+    }
+  }
+
+  // out[i + k*n] = sum(x[i,1:index[i + k*n]]): each row is evaluated at its own columns (nIndex per row).
+  // One pass over the columns for each block of rows, evaluating all columns of index at once:
+  // within a block the requested positions are bucketed by column of x.
+  void evalRows(const IntegerVector& index, int nIndex, double* out, int ncores) const {
+    checkIndex(index);
+    const int blockSize = 512;
+    int nBlock = (n + blockSize - 1) / blockSize;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(ncores > 0 ? ncores : 1) if(nBlock > 1)
+#endif
+    for(int iBlock=0; iBlock<nBlock; iBlock++){
+      int iStart = iBlock * blockSize;
+      int iSize = std::min(blockSize, n - iStart);
+      // bucket the requested positions by column of x (counting sort)
+      std::vector<int> bucketStart(p+2, 0);
+      int maxIndex = 0;
+      for(int k=0; k<nIndex; k++){
+        for(int iRow=0; iRow<iSize; iRow++){
+          size_t iPos = (size_t)k * n + iStart + iRow;
+          if(index[iPos] == NA_INTEGER){
+            out[iPos] = NA_REAL;
+          }else{
+            bucketStart[index[iPos]+1]++;
+            maxIndex = std::max(maxIndex, (int)index[iPos]);
+          }
+        }
+      }
+      for(int iCol=0; iCol<=p; iCol++){
+        bucketStart[iCol+1] += bucketStart[iCol];
+      }
+      std::vector<int> bucketFill(bucketStart.begin(), bucketStart.end()-1);
+      std::vector<int> bucketRow(bucketStart[p+1]);
+      std::vector<size_t> bucketPos(bucketStart[p+1]);
+      for(int k=0; k<nIndex; k++){
+        for(int iRow=0; iRow<iSize; iRow++){
+          size_t iPos = (size_t)k * n + iStart + iRow;
+          if(index[iPos] != NA_INTEGER){
+            int iB = bucketFill[index[iPos]]++;
+            bucketRow[iB] = iRow;
+            bucketPos[iB] = iPos;
+          }
+        }
+      }
+      // running sums of the block, stored at the requested columns
+      std::vector<double> iSum(iSize, 0.0);
+      for(int iCol=0; iCol<=maxIndex; iCol++){
+        if(iCol>0){
+          const double* iX = X + (size_t)(iCol-1) * n + iStart;
+          for(int iRow=0; iRow<iSize; iRow++){
+            iSum[iRow] += iX[iRow];
+          }
+        }
+        for(int iB=bucketStart[iCol]; iB<bucketStart[iCol+1]; iB++){
+          out[bucketPos[iB]] = iSum[bucketRow[iB]];
+        }
+      }
+    }
+  }
+
+private:
+  const double* X;
+  int n;
+  int p;
+
+  // check that the indexes are valid and return the largest one
+  int checkIndex(const IntegerVector& index) const {
+    int maxIndex = 0;
+    for(int k=0; k<index.size(); k++){
+      if(index[k] == NA_INTEGER){
+        continue;
+      }
+      if(index[k] < 0 || index[k] > p){
+        stop("Argument \'index\' should contain integers between 0 and %i (number of columns of argument \'x\').", p);
+      }
+      maxIndex = std::max(maxIndex, (int)index[k]);
+    }
+    return maxIndex;
+  }
+};
+
+//' Cumulative sums in each row at specific columns
+//'
+//' @description Fast computation of subsetIndex(rowCumSum(x), index, default = 0),
+//' or of rowCumSum(x)[cbind(1:nrow(x),index)] when \code{diag} is \code{TRUE},
+//' without storing the cumulative sums at the columns that are not requested.
+//' @param x A matrix.
+//' @param index [integer vector] the columns at which the cumulative sums should be evaluated.
+//' 0 corresponds to an empty sum (i.e. 0) and NA to NA.
+//' @param diag [logical] should the cumulative sum of each row be evaluated at a different column?
+//' In that case \code{index} should contain one column per row,
+//' or be a matrix with as many rows as x to evaluate each row at several columns (e.g. one per time horizon).
+//' @param ncores [integer] number of threads over which the blocks of rows are distributed (when compiled with OpenMP).
+//' @return A matrix with as many rows as x and as many columns as the length of index,
+//' or when \code{diag} is \code{TRUE} a vector with as many elements as the number of rows of x
+//' (a matrix of same size as index when index is a matrix).
+//' @examples
+//' x <- matrix(1:8,ncol=4)
+//' rowCumSumIndex(x, index = c(0,2,4))
+//' subsetIndex(rowCumSum(x), index = c(0,2,4), default = 0)
+//'
+//' rowCumSumIndex(x, index = c(3,1), diag = TRUE)
+//' rowCumSumIndex(x, index = cbind(c(3,1),c(4,0)), diag = TRUE)
 //' @export
 // [[Rcpp::export]]
-NumericMatrix rowCumSum(NumericMatrix x){
-  arma::mat m(x.begin(), x.nrow(), x.ncol(), false);
-  arma::mat result;
-  result=cumsum(m,1);
-  return wrap(result);
+NumericVector rowCumSumIndex(NumericMatrix x, IntegerVector index, bool diag = false, int ncores = 1){
+  RowCumSumView view(x);
+  if(diag){
+    int n = x.nrow();
+    if(index.hasAttribute("dim")){
+      IntegerVector dim = index.attr("dim");
+      if(dim.size() != 2 || dim[0] != n){
+        stop("Argument \'index\' should be a matrix with %i rows (number of rows of argument \'x\').", n);
+      }
+      NumericMatrix out(Rcpp::no_init(n, dim[1]));
+      view.evalRows(index, dim[1], out.begin(), ncores);
+      return out;
+    }
+    if(index.size() != n){
+      stop("Argument \'index\' should have length %i (number of rows of argument \'x\') instead of %i.", n, index.size());
+    }
+    NumericVector out(Rcpp::no_init(n));
+    view.evalRows(index, 1, out.begin(), ncores);
+    return out;
+  }else{
+    NumericMatrix out(Rcpp::no_init(x.nrow(), index.size()));
+    view.evalColumns(index, out.begin(), ncores);
+    return out;
+  }
 }
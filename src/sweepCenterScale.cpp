@@ -1,9 +1,20 @@
 // [[Rcpp::depends(RcppArmadillo)]]
 #include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace Rcpp;
 using namespace std;
 
+void checkSweep_cpp(const arma::mat& X, int nStat, bool byColumn, const char* name);
+NumericMatrix initSweep_cpp(const arma::mat& X, int nStat, bool byColumn, const char* name);
+void rowMultiplySumKernel(const double* X, int n, int p, size_t stride, const double* scale, double factor,
+                          double* out, int ncores);
+
+// The input matrix is passed by reference (no copy) and the result is written directly in the memory
+// of the R matrix which is returned (no copy on return), i.e. each call costs one pass over the memory.
+
 // * colCenter (documentation)
 //' @title Apply - by column
 //' @description Fast computation of sweep(X, MARGIN = 1, FUN = "-", STATS = center)
@@ -25,9 +36,13 @@ using namespace std;
 //' @rdname colCenter_cpp
 //' @export
 // [[Rcpp::export]]
-arma::mat colCenter_cpp(arma::mat X, const arma::colvec& center){
-  X.each_col() -= center;
-  return(X);
+NumericMatrix colCenter_cpp(const arma::mat& X, const arma::colvec& center){
+  NumericMatrix out = initSweep_cpp(X, center.n_elem, true, "center");
+  arma::mat M(out.begin(), X.n_rows, X.n_cols, false, true);
+  for(arma::uword iCol=0; iCol<X.n_cols; iCol++){
+    M.col(iCol) = X.col(iCol) - center;
+  }
+  return(out);
 }
 
 // * rowCenter (documentation)
@@ -51,9 +66,13 @@ arma::mat colCenter_cpp(arma::mat X, const arma::colvec& center){
 //' @rdname rowCenter_cpp
 //' @export
 // [[Rcpp::export]]
-arma::mat rowCenter_cpp(arma::mat X, const arma::rowvec& center){
-  X.each_row() -= center;
-  return(X);
+NumericMatrix rowCenter_cpp(const arma::mat& X, const arma::rowvec& center){
+  NumericMatrix out = initSweep_cpp(X, center.n_elem, false, "center");
+  arma::mat M(out.begin(), X.n_rows, X.n_cols, false, true);
+  for(arma::uword iCol=0; iCol<X.n_cols; iCol++){
+    M.col(iCol) = X.col(iCol) - center(iCol);
+  }
+  return(out);
 }
 
 
@@ -77,9 +96,13 @@ arma::mat rowCenter_cpp(arma::mat X, const arma::rowvec& center){
 //' @rdname colScale_cpp
 //' @export
 // [[Rcpp::export]]
-arma::mat colScale_cpp(arma::mat X, const arma::colvec& scale){
-  X.each_col() /= scale;
-  return(X);
+NumericMatrix colScale_cpp(const arma::mat& X, const arma::colvec& scale){
+  NumericMatrix out = initSweep_cpp(X, scale.n_elem, true, "scale");
+  arma::mat M(out.begin(), X.n_rows, X.n_cols, false, true);
+  for(arma::uword iCol=0; iCol<X.n_cols; iCol++){
+    M.col(iCol) = X.col(iCol) / scale;
+  }
+  return(out);
 }
 
 // * rowScale_cpp (documentation)
@@ -103,9 +126,13 @@ arma::mat colScale_cpp(arma::mat X, const arma::colvec& scale){
 //' @rdname rowScale_cpp
 //' @export
 // [[Rcpp::export]]
-arma::mat rowScale_cpp(arma::mat X, const arma::rowvec& scale){
-  X.each_row() /= scale;
-  return(X);
+NumericMatrix rowScale_cpp(const arma::mat& X, const arma::rowvec& scale){
+  NumericMatrix out = initSweep_cpp(X, scale.n_elem, false, "scale");
+  arma::mat M(out.begin(), X.n_rows, X.n_cols, false, true);
+  for(arma::uword iCol=0; iCol<X.n_cols; iCol++){
+    M.col(iCol) = X.col(iCol) / scale(iCol);
+  }
+  return(out);
 }
 
 // * colMultiply_cpp (documentation)
@@ -127,9 +154,13 @@ arma::mat rowScale_cpp(arma::mat X, const arma::rowvec& scale){
 //' @name colMultiply_cpp
 //' @export
 // [[Rcpp::export]]
-arma::mat colMultiply_cpp(arma::mat X, const arma::colvec& scale){
-  X.each_col() %= scale;
-  return(X);
+NumericMatrix colMultiply_cpp(const arma::mat& X, const arma::colvec& scale){
+  NumericMatrix out = initSweep_cpp(X, scale.n_elem, true, "scale");
+  arma::mat M(out.begin(), X.n_rows, X.n_cols, false, true);
+  for(arma::uword iCol=0; iCol<X.n_cols; iCol++){
+    M.col(iCol) = X.col(iCol) % scale;
+  }
+  return(out);
 }
 
 // * rowMultiply_cpp (documentation)
@@ -153,8 +184,155 @@ arma::mat colMultiply_cpp(arma::mat X, const arma::colvec& scale){
 //' @name rowMultiply_cpp
 //' @export
 // [[Rcpp::export]]
-arma::mat rowMultiply_cpp(arma::mat X, const arma::rowvec& scale){
-  X.each_row() %= scale;
-  return(X);
+NumericMatrix rowMultiply_cpp(const arma::mat& X, const arma::rowvec& scale){
+  NumericMatrix out = initSweep_cpp(X, scale.n_elem, false, "scale");
+  arma::mat M(out.begin(), X.n_rows, X.n_cols, false, true);
+  for(arma::uword iCol=0; iCol<X.n_cols; iCol++){
+    M.col(iCol) = X.col(iCol) * scale(iCol);
+  }
+  return(out);
+}
+
+// * colCenterScale_cpp (documentation)
+//' @title Apply - and / by column
+//' @description Fast computation of sweep(sweep(X, MARGIN = 1, FUN = "-", STATS = center), MARGIN = 1, FUN = "/", STATS = scale)
+//' @name colCenterScale_cpp
+//' 
+//' @param X A matrix.
+//' @param center a numeric vector of length equal to the number of rows of \code{x}
+//' @param scale a numeric vector of length equal to the number of rows of \code{x}
+//' 
+//' @return A matrix of same size as X.
+//' @examples
+//' x <- matrix(1,6,5)
+//' sweep(sweep(x, MARGIN = 1, FUN = "-", STATS = 1:6), MARGIN = 1, FUN = "/", STATS = 6:1)
+//' colCenterScale_cpp(x, 1:6, 6:1)
+
+// * colCenterScale_cpp (code)
+//' @rdname colCenterScale_cpp
+//' @export
+// [[Rcpp::export]]
+NumericMatrix colCenterScale_cpp(const arma::mat& X, const arma::colvec& center, const arma::colvec& scale){
+  checkSweep_cpp(X, scale.n_elem, true, "scale");
+  NumericMatrix out = initSweep_cpp(X, center.n_elem, true, "center");
+  arma::mat M(out.begin(), X.n_rows, X.n_cols, false, true);
+  for(arma::uword iCol=0; iCol<X.n_cols; iCol++){
+    M.col(iCol) = (X.col(iCol) - center) / scale;
+  }
+  return(out);
 }
 
+// * rowCenterScale_cpp (documentation)
+//' @title Apply - and / by row
+//' @description Fast computation of sweep(sweep(X, MARGIN = 2, FUN = "-", STATS = center), MARGIN = 2, FUN = "/", STATS = scale)
+//' @name rowCenterScale_cpp
+//' 
+//' @param X A matrix.
+//' @param center a numeric vector of length equal to the number of columns of \code{x}
+//' @param scale a numeric vector of length equal to the number of columns of \code{x}
+//' 
+//' @return A matrix of same size as X.
+//' @examples
+//' x <- matrix(1,6,5)
+//' sweep(sweep(x, MARGIN = 2, FUN = "-", STATS = 1:5), MARGIN = 2, FUN = "/", STATS = 5:1)
+//' rowCenterScale_cpp(x, 1:5, 5:1)
+
+// * rowCenterScale_cpp (code)
+//' @rdname rowCenterScale_cpp
+//' @export
+// [[Rcpp::export]]
+NumericMatrix rowCenterScale_cpp(const arma::mat& X, const arma::rowvec& center, const arma::rowvec& scale){
+  checkSweep_cpp(X, scale.n_elem, false, "scale");
+  NumericMatrix out = initSweep_cpp(X, center.n_elem, false, "center");
+  arma::mat M(out.begin(), X.n_rows, X.n_cols, false, true);
+  for(arma::uword iCol=0; iCol<X.n_cols; iCol++){
+    M.col(iCol) = (X.col(iCol) - center(iCol)) / scale(iCol);
+  }
+  return(out);
+}
+
+// * rowMultiplySum_cpp
+// Fast computation of rowSums(rowMultiply_cpp(X, scale)) or rowMeans(rowMultiply_cpp(X, scale)),
+// i.e. X %*% scale (possibly divided by ncol(X)), without allocating the scaled matrix.
+// [[Rcpp::export(rng = false)]]
+NumericVector rowMultiplySum_cpp(NumericMatrix X, NumericVector scale, bool mean = false, int ncores = 1){
+  int n = X.nrow(), p = X.ncol();
+  if(scale.size() != p){
+    stop("Argument \'scale\' should have length %i (number of columns of argument \'X\') instead of %i.",
+         p, scale.size());
+  }
+  NumericVector out(n);
+  rowMultiplySumKernel(X.begin(), n, p, n, scale.begin(), (mean && p>0) ? 1.0/p : 1.0, out.begin(), ncores);
+  return(out);
+}
+
+// * sliceRowMultiplySum_cpp
+// Same as rowMultiplySum_cpp applied to the matrix X[,col,] extracted from the 3 dimensional array X
+// (col is 1-based, as in R). The slice is read in place: neither the slice nor the scaled slice is allocated.
+// [[Rcpp::export(rng = false)]]
+NumericVector sliceRowMultiplySum_cpp(NumericVector X, int col, NumericVector scale, bool mean = false, int ncores = 1){
+  IntegerVector dim = X.attr("dim");
+  if(dim.size() != 3){
+    stop("Argument \'X\' should be an array with 3 dimensions.");
+  }
+  int n = dim[0], p = dim[2];
+  if(col < 1 || col > dim[1]){
+    stop("Argument \'col\' should be between 1 and %i.", dim[1]);
+  }
+  if(scale.size() != p){
+    stop("Argument \'scale\' should have length %i (third dimension of argument \'X\') instead of %i.",
+         p, scale.size());
+  }
+  NumericVector out(n);
+  rowMultiplySumKernel(X.begin() + (size_t)(col-1) * n, n, p, (size_t)n * dim[1], scale.begin(),
+                       (mean && p>0) ? 1.0/p : 1.0, out.begin(), ncores);
+  return(out);
+}
+
+// * rowMultiplySumKernel
+// out[i] = factor * sum_j X[i + j*stride] * scale[j] for i=0..n-1
+// rows are split into blocks distributed over ncores threads (when compiled with OpenMP);
+// within a block the columns are read one after the other so that memory is accessed contiguously.
+void rowMultiplySumKernel(const double* X, int n, int p, size_t stride, const double* scale, double factor,
+                          double* out, int ncores){
+  const int blockSize = 256;
+  int nBlock = (n + blockSize - 1) / blockSize;
+  
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(ncores > 0 ? ncores : 1) if(nBlock > 1)
+#endif
+  for(int iBlock=0; iBlock<nBlock; iBlock++){
+    int iStart = iBlock * blockSize;
+    int iEnd = std::min(iStart + blockSize, n);
+    double* iOut = out + iStart;
+    for(int iCol=0; iCol<p; iCol++){
+      const double* iX = X + iCol * stride + iStart;
+      double iScale = scale[iCol];
+      for(int iRow=0; iRow<iEnd-iStart; iRow++){
+        iOut[iRow] += iX[iRow] * iScale;
+      }
+    }
+    if(factor != 1.0){
+      for(int iRow=0; iRow<iEnd-iStart; iRow++){
+        iOut[iRow] *= factor;
+      }
+    }
+  }
+}
+
+// * checkSweep_cpp
+// check the length of the statistic
+void checkSweep_cpp(const arma::mat& X, int nStat, bool byColumn, const char* name){
+  int nExpected = byColumn ? X.n_rows : X.n_cols;
+  if(nStat != nExpected){
+    stop("Argument \'%s\' should have length %i (number of %s of argument \'X\') instead of %i.",
+         name, nExpected, byColumn ? "rows" : "columns", nStat);
+  }
+}
+
+// * initSweep_cpp
+// check the length of the statistic and allocate the R matrix containing the result
+NumericMatrix initSweep_cpp(const arma::mat& X, int nStat, bool byColumn, const char* name){
+  checkSweep_cpp(X, nStat, byColumn, name);
+  return(NumericMatrix(X.n_rows, X.n_cols));
+}
@@ -1,5 +1,7 @@
 // [[Rcpp::depends(RcppArmadillo)]]
 #include <RcppArmadillo.h>
+#include <algorithm>
+#include <vector>
 
 using namespace Rcpp;
 using namespace std;
@@ -10,7 +12,15 @@ using namespace std;
 // p: number of regressors
 // S: number of strata
 // T: number of prediction times
-// should be able to speed this part up by using the trick with firsthit
+// firsthit: should the weighted sum of the influence functions be computed directly?
+//           Instead of forming one n-length influence function per prediction, the weights of the predictions are aggregated
+//           by prediction time and by jump time and the influence function of each training observation is obtained
+//           from cumulative sums, by locating its event time among the sorted prediction times (binary search)
+//           and its jump index among the jump times (firsthit). Complexity O((n+T) log T + J) per strata instead of O(n T).
+// reduceFirst: should the weighted sum over the predictions be computed before forming the influence function?
+//              By linearity sum_i w_i eXb_i (IF0 + cumhazard0 IFbeta x_i) = (sum_i w_i eXb_i) IF0 + cumhazard0 IFbeta (sum_i w_i eXb_i x_i)
+//              so only one n-length vector operation and one matrix-vector product are performed per prediction time.
+//              Same result up to floating point rounding. Also used by the firsthit algorithm.
 // [[Rcpp::export]]
 NumericVector weightedAverageIFCumhazard_cpp(const arma::vec& seqTau, // horizon time for the predictions (T)
                                              const std::vector< arma::vec > & cumhazard0, // baseline cumulative hazard for each strata S:T
@@ -32,7 +42,9 @@ NumericVector weightedAverageIFCumhazard_cpp(const arma::vec& seqTau, // horizon
                                              int debug,
                                              const arma::vec& weights,
                                              bool isBeforeTau,
-                                             double tau){ 
+                                             double tau,
+                                             bool firsthit = false,
+                                             bool reduceFirst = false){ 
   
   // ** prepare
   if(debug>0){Rcpp::Rcout << "Prepare" << std::endl;}
@@ -48,6 +60,18 @@ NumericVector weightedAverageIFCumhazard_cpp(const arma::vec& seqTau, // horizon
   arma::colvec iStrata_IFcumhazard;
   
   arma::uvec index_timestop(nSample);
+
+  // firsthit algorithm
+  std::vector< std::pair<double,double> > iStrata_weightTau; // prediction time and corresponding weight
+  arma::vec iStrata_weightJump; // weight of each jump time
+  arma::vec iStrata_weightCumhazardJump; // weight of each jump time times the cumulative hazard at the jump
+  arma::vec iStrata_sumWeight; // suffix sum of the weights over the sorted prediction times
+  arma::vec sumWeightX(p > 0 ? p : 1, arma::fill::zeros); // weighted sum of the terms multiplying IFbeta
+
+  // reduction over the predictions
+  bool reduce = firsthit || reduceFirst;
+  double iWeight = 0, iStrata_weight = 0; // sum of w_i eXb_i
+  arma::vec iWeightX, iStrata_weightX; // sum of w_i eXb_i x_i
   
   // ** initialize
   if(debug>0){Rcpp::Rcout << "Initialize" << std::endl;}
@@ -95,6 +119,25 @@ NumericVector weightedAverageIFCumhazard_cpp(const arma::vec& seqTau, // horizon
     R_CheckUserInterrupt();
     
     if(debug>1){Rcpp::Rcout << " (tau=" << iStrata_tauMin << "-" << iStrata_tauMax << ") ";}
+
+    if(firsthit){
+      iStrata_weightTau.clear();
+      iStrata_weightJump.zeros(cumhazard_iS0[iStrata].n_elem);
+      iStrata_weightCumhazardJump.zeros(cumhazard_iS0[iStrata].n_elem);
+    }
+    if(reduce && !diag){ // all predictions are made at all times: aggregate their weights once
+      iStrata_weight = 0;
+      iStrata_weightX.zeros(p);
+      for(int iNewObs=0; iNewObs<iStrata_nNewObs; iNewObs++){
+        iNewObs2 = newdata_index[iStrata](iNewObs);
+        if(p>0){
+          iStrata_weight += weights[iNewObs2]*neweXb(iNewObs2);
+          iStrata_weightX += (weights[iNewObs2]*neweXb(iNewObs2)) * trans(newX.row(iNewObs2));
+        }else{
+          iStrata_weight += weights[iNewObs2];
+        }
+      }
+    }
     
     // *** compute IF/SE/IFmean at each time point
     for(int iTime=iStrata_tauMin; iTime<=iStrata_tauMax; iTime++){
@@ -113,6 +156,32 @@ NumericVector weightedAverageIFCumhazard_cpp(const arma::vec& seqTau, // horizon
       // jump
       iJump = iStrata_indexJumpTau(iTime);
       
+      // **** aggregate the weights of the predictions at this time
+      if(reduce){
+        if(diag){
+          iNewObs2 = newdata_index[iStrata](iTime);
+          if(p>0){
+            iWeight = weights[iNewObs2]*neweXb(iNewObs2);
+            iWeightX = iWeight * trans(newX.row(iNewObs2));
+          }else{
+            iWeight = weights[iNewObs2];
+          }
+        }else{
+          iWeight = iStrata_weight;
+          iWeightX = iStrata_weightX;
+        }
+      }
+
+      if(firsthit){
+        iStrata_weightTau.push_back(std::make_pair(iStrata_seqTau(iTime), iWeight));
+        iStrata_weightJump(iJump) += iWeight;
+        iStrata_weightCumhazardJump(iJump) += iWeight * cumhazard_iS0[iStrata](iJump);
+        if(p>0){
+          sumWeightX += cumhazard0[iStrata](iTau) * iWeightX - iWeight * cumEhazard0[iStrata].col(iTau);
+        }
+        continue;
+      }
+      
       if(debug>1){Rcpp::Rcout << " IF0 " ;}
       
       // **** IF baseline cumulative hazard hazard 
@@ -126,6 +195,13 @@ NumericVector weightedAverageIFCumhazard_cpp(const arma::vec& seqTau, // horizon
       
       // **** IF/SE hazard/cumhazard/survival
       if(debug>1){Rcpp::Rcout << " IF " ;}
+      if(reduceFirst){
+        IF_cumhazard += iWeight * iStrata_IFcumhazard0;
+        if(p>0){
+          IF_cumhazard += IFbeta * (cumhazard0[iStrata](iTau) * iWeightX);
+        }
+        continue;
+      }
       for(int iNewObs=0; iNewObs<iStrata_nNewObs; iNewObs++){
         if(diag){
           iNewObs2 = newdata_index[iStrata](iTime);
@@ -144,11 +220,51 @@ NumericVector weightedAverageIFCumhazard_cpp(const arma::vec& seqTau, // horizon
         IF_cumhazard += iStrata_IFcumhazard*weights[iNewObs2];
       }
     } // end iTime
+
+    if(firsthit && iStrata_weightTau.size()>0){
+      // **** sum of the weights of the prediction times after each event time
+      int nWeightTau = iStrata_weightTau.size();
+      std::sort(iStrata_weightTau.begin(), iStrata_weightTau.end());
+      std::vector<double> iStrata_seqTauSorted(nWeightTau);
+      iStrata_sumWeight.zeros(nWeightTau+1);
+      for(int iTime=nWeightTau-1; iTime>=0; iTime--){
+        iStrata_seqTauSorted[iTime] = iStrata_weightTau[iTime].first;
+        iStrata_sumWeight(iTime) = iStrata_sumWeight(iTime+1) + iStrata_weightTau[iTime].second;
+      }
+      // **** sum of the weights of the jumps before (cumhazard at the jump) and after (cumhazard at the event time) each event time
+      int nJump = iStrata_weightJump.n_elem;
+      arma::vec iStrata_sumWeightJumpAfter(nJump+1, arma::fill::zeros);
+      arma::vec iStrata_sumWeightJumpBefore(nJump+1, arma::fill::zeros);
+      for(int iJ=nJump-1; iJ>=0; iJ--){
+        iStrata_sumWeightJumpAfter(iJ) = iStrata_sumWeightJumpAfter(iJ+1) + iStrata_weightJump(iJ);
+      }
+      for(int iJ=0; iJ<nJump; iJ++){
+        iStrata_sumWeightJumpBefore(iJ+1) = iStrata_sumWeightJumpBefore(iJ) + iStrata_weightCumhazardJump(iJ);
+      }
+      // **** influence function of each training observation
+      for(int iObs=0; iObs<nSample; iObs++){
+        if(delta_iS0(iObs,iStrata) != 0){
+          int iPos = std::lower_bound(iStrata_seqTauSorted.begin(), iStrata_seqTauSorted.end(), sample_time(iObs)) - iStrata_seqTauSorted.begin();
+          IF_cumhazard(iObs) += delta_iS0(iObs,iStrata) * iStrata_sumWeight(iPos);
+        }
+        if(sample_eXb(iObs,iStrata) != 0){
+          arma::uword iFirst = std::min((arma::uword) nJump, indexJumpSample_time[iStrata](iObs)); // last jump before the event time
+          double iCumhazard = iStrata_sumWeightJumpBefore(iFirst);
+          if(iFirst < (arma::uword) nJump){
+            iCumhazard += cumhazard_iS0[iStrata](iFirst) * iStrata_sumWeightJumpAfter(iFirst);
+          }
+          IF_cumhazard(iObs) -= sample_eXb(iObs,iStrata) * iCumhazard;
+        }
+      }
+    }
     if(debug>1){Rcpp::Rcout << std::endl;}
   } // end iStrata
   
   // ** Post process
   if(debug>0){Rcpp::Rcout << "Post process" << std::endl;}
+  if(firsthit && p>0){
+    IF_cumhazard += IFbeta * sumWeightX;
+  }
   
   // ** Export
   if(debug>0){Rcpp::Rcout << "Export" << std::endl;}